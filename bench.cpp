@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "core/orderbook.h"
+#include "core/replay.h"
+#include "core/tape.h"
+
+using namespace OrderbookCore;
+
+namespace {
+constexpr std::size_t kOrderCount = 1'000'000;
+
+template <typename Body> double NanosecondsPerOp(std::size_t count, Body &&body) {
+  const auto start = std::chrono::steady_clock::now();
+  body();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / count;
+}
+
+// hardware cache misses of the calling thread. virtual machines and locked down kernels often expose no counter,
+// the benchmark then reports timings only
+class CacheMissCounter {
+public:
+  CacheMissCounter() {
+#ifdef __linux__
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+  ~CacheMissCounter() {
+#ifdef __linux__
+    if (m_fd >= 0)
+      close(m_fd);
+#endif
+  }
+
+  bool Available() const { return m_fd >= 0; }
+  void Start() {
+#ifdef __linux__
+    ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+  uint64_t Stop() {
+    uint64_t count = 0;
+#ifdef __linux__
+    ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+      count = 0;
+#endif
+    return count;
+  }
+
+private:
+  int m_fd{-1};
+};
+
+// alternating sides around a random walk, so roughly every other order crosses
+std::vector<OrderPtr> CrossingOrders(std::size_t count, ParticipantId (*participant)(std::size_t), SelfTradePrevention prevention) {
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<Price> step{-2, 2};
+  std::uniform_int_distribution<Quantity> quantity{1, 100};
+  std::vector<OrderPtr> orders;
+  orders.reserve(count);
+
+  Price mid = 10'000;
+  for (std::size_t i = 0; i < count; ++i) {
+    mid += step(rng);
+    OrderPtr order = i % 2 ? static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Buy>>(i + 1, mid + 1, quantity(rng)))
+                           : static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Sell>>(i + 1, mid - 1, quantity(rng)));
+    order->SetParticipant(participant(i), prevention);
+    orders.push_back(order);
+  }
+  return orders;
+}
+
+// best of a few runs, so a noisy neighbour does not fail the gate. a budget of 0 only reports
+bool BenchMatching(double budget) {
+  constexpr int run_count = 3;
+  double best = 0;
+  std::size_t trade_count = 0;
+  for (int run = 0; run < run_count; ++run) {
+    auto orders = CrossingOrders(kOrderCount, [](std::size_t) -> ParticipantId { return 0; }, SelfTradePrevention::None);
+    Orderbook orderbook{{kOrderCount, 9'000, 11'000}};
+    trade_count = 0;
+    double ns = NanosecondsPerOp(orders.size(), [&] {
+      for (const auto &order : orders)
+        trade_count += orderbook.AddOrder(order).size();
+    });
+    best = run ? std::min(best, ns) : ns;
+  }
+
+  std::cout << "Matching, " << kOrderCount << " crossing orders, best of " << run_count << std::endl;
+  std::cout << "  " << best << " ns/order (" << 1e9 / best << " orders/s), " << trade_count << " trades";
+  if (budget > 0)
+    std::cout << ", budget " << budget << " ns/order " << (best <= budget ? "met" : "MISSED");
+  std::cout << std::endl;
+  return budget <= 0 || best <= budget;
+}
+
+void BenchSelfTradePrevention() {
+  struct Workload {
+    const char *m_name;
+    ParticipantId (*m_participant)(std::size_t);
+    SelfTradePrevention m_prevention;
+  };
+  const Workload workloads[] = {
+      {"anonymous (check skipped)", [](std::size_t) -> ParticipantId { return 0; }, SelfTradePrevention::None},
+      {"distinct participants", [](std::size_t i) -> ParticipantId { return 1 + i % 1000; }, SelfTradePrevention::CancelOldest},
+      {"self match, cancel oldest", [](std::size_t i) -> ParticipantId { return 1 + (i % 10 == 0); }, SelfTradePrevention::CancelOldest},
+      {"self match, decrement", [](std::size_t i) -> ParticipantId { return 1 + (i % 10 == 0); }, SelfTradePrevention::Decrement},
+  };
+
+  std::cout << "Self trade prevention, " << kOrderCount << " crossing orders" << std::endl;
+  for (const auto &workload : workloads) {
+    auto orders = CrossingOrders(kOrderCount, workload.m_participant, workload.m_prevention);
+    Orderbook orderbook{{kOrderCount, 9'000, 11'000}};
+    std::size_t trade_count = 0;
+    double ns = NanosecondsPerOp(orders.size(), [&] {
+      for (const auto &order : orders)
+        trade_count += orderbook.AddOrder(order).size();
+    });
+    std::cout << "  " << workload.m_name << ": " << ns << " ns/order, " << trade_count << " trades" << std::endl;
+  }
+}
+
+// the budget applies to ns/order, cache misses are only reported since the counter is often unavailable on VMs
+bool BenchLayout(double budget) {
+  constexpr std::size_t book_count = 64;
+  constexpr std::size_t orders_per_book = 20'000;
+  // many books on one core: orders go round robin, so each book finds its hot state evicted by the other 63
+  std::vector<std::unique_ptr<Orderbook>> orderbooks;
+  std::vector<std::vector<OrderPtr>> flows;
+  for (std::size_t i = 0; i < book_count; ++i) {
+    orderbooks.push_back(std::make_unique<Orderbook>(OrderbookConfig{orders_per_book, 9'000, 11'000}));
+    flows.push_back(CrossingOrders(orders_per_book, [](std::size_t) -> ParticipantId { return 0; }, SelfTradePrevention::None));
+  }
+
+  CacheMissCounter counter;
+  counter.Start();
+  double ns = NanosecondsPerOp(book_count * orders_per_book, [&] {
+    for (std::size_t order = 0; order < orders_per_book; ++order)
+      for (std::size_t book = 0; book < book_count; ++book)
+        orderbooks[book]->AddOrder(flows[book][order]);
+  });
+  const uint64_t misses = counter.Stop();
+
+  std::cout << "Layout, " << book_count << " books sharing a core, sizeof(Orderbook) " << sizeof(Orderbook) << std::endl;
+  std::cout << "  " << ns << " ns/order";
+  if (counter.Available())
+    std::cout << ", " << static_cast<double>(misses) / (book_count * orders_per_book) << " cache misses/order";
+  else
+    std::cout << ", cache miss counter unavailable";
+  if (budget > 0)
+    std::cout << ", budget " << budget << " ns/order " << (ns <= budget ? "met" : "MISSED");
+  std::cout << std::endl;
+  return budget <= 0 || ns <= budget;
+}
+
+void BenchMassCancel() {
+  constexpr std::size_t resting_count = 100'000;
+  // one disconnecting participant owns every resting order, spread over 1000 levels a side
+  auto FillBook = [](Orderbook &orderbook) {
+    OrderIds ids;
+    ids.reserve(resting_count);
+    for (OrderId id = 1; id <= resting_count; ++id) {
+      OrderPtr order = id % 2 ? static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Buy>>(id, 9'000 + id % 1000, 10))
+                              : static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Sell>>(id, 11'000 + id % 1000, 10));
+      order->SetParticipant(1, SelfTradePrevention::None);
+      orderbook.AddOrder(order);
+      ids.push_back(id);
+    }
+    return ids;
+  };
+
+  std::cout << "Mass cancel, " << resting_count << " resting orders" << std::endl;
+  {
+    Orderbook orderbook{{resting_count, 9'000, 12'000}};
+    OrderIds ids = FillBook(orderbook);
+    // a client's id list follows its own bookkeeping, not the book's memory layout
+    std::shuffle(ids.begin(), ids.end(), std::mt19937{42});
+    double ns = NanosecondsPerOp(resting_count, [&] { orderbook.CancelOrders(ids); });
+    std::cout << "  per id: " << ns * resting_count / 1e6 << " ms (" << ns << " ns/order)" << std::endl;
+  }
+  {
+    Orderbook orderbook{{resting_count, 9'000, 12'000}};
+    FillBook(orderbook);
+    double ns = NanosecondsPerOp(resting_count, [&] { orderbook.CancelParticipantOrders(1); });
+    std::cout << "  participant: " << ns * resting_count / 1e6 << " ms (" << ns << " ns/order)" << std::endl;
+  }
+  {
+    Orderbook orderbook{{resting_count, 9'000, 12'000}};
+    FillBook(orderbook);
+    double ns = NanosecondsPerOp(resting_count, [&] {
+      orderbook.CancelOrders(Side::Buy);
+      orderbook.CancelOrders(Side::Sell);
+    });
+    std::cout << "  both sides: " << ns * resting_count / 1e6 << " ms (" << ns << " ns/order)" << std::endl;
+  }
+  {
+    Orderbook orderbook{{resting_count, 9'000, 12'000}};
+    FillBook(orderbook);
+    double ns = NanosecondsPerOp(resting_count, [&] {
+      orderbook.CancelOrders(Side::Buy, 9'000, 10'000);
+      orderbook.CancelOrders(Side::Sell, 11'000, 12'000);
+    });
+    std::cout << "  price range: " << ns * resting_count / 1e6 << " ms (" << ns << " ns/order)" << std::endl;
+  }
+}
+
+// a 1,000 symbol day with skewed activity. one symbol is one task, so the busiest name bounds the speedup: at
+// 1 / sqrt(rank) it carries under 2% of the flow, steeper skews stop scaling once a core is left with just that name
+ReplayStream RecordedDay(std::size_t symbol_count, std::size_t event_count) {
+  std::mt19937 rng{42};
+  std::vector<double> weights(symbol_count);
+  for (std::size_t i = 0; i < symbol_count; ++i)
+    weights[i] = 1.0 / std::sqrt(i + 1.0);
+  std::discrete_distribution<std::size_t> pick_symbol{weights.begin(), weights.end()};
+  std::uniform_int_distribution<int> event{0, 99};
+  std::uniform_int_distribution<Price> step{-1, 1};
+  std::uniform_int_distribution<Price> depth{1, 10};
+  std::uniform_int_distribution<Quantity> quantity{1, 200};
+
+  std::vector<Price> mids(symbol_count, 10'000);
+  std::vector<OrderId> next_ids(symbol_count, 1);
+  ReplayStream stream;
+  for (uint64_t sequence = 1; sequence <= event_count; ++sequence) {
+    const std::size_t symbol = pick_symbol(rng);
+    Price &mid = mids[symbol];
+    mid += step(rng);
+    const Side side = rng() % 2 ? Side::Buy : Side::Sell;
+    ReplayEvent replay_event{sequence, ReplayAction::Add, side, "GTC", 0, side == Side::Buy ? mid - depth(rng) : mid + depth(rng), quantity(rng), 0, 0};
+
+    const int kind = event(rng);
+    if (next_ids[symbol] > 1 && kind < 45) {
+      replay_event.m_action = kind < 35 ? ReplayAction::Cancel : ReplayAction::Modify;
+      replay_event.m_order_id = std::uniform_int_distribution<OrderId>{1, next_ids[symbol] - 1}(rng);
+    } else {
+      if (kind >= 95) {
+        replay_event.m_type = "FAK";
+        replay_event.m_price = side == Side::Buy ? mid + 5 : mid - 5;
+      }
+      replay_event.m_order_id = next_ids[symbol]++;
+    }
+    stream.Append("SYM" + std::to_string(symbol), replay_event);
+  }
+  return stream;
+}
+
+void BenchReplay() {
+  constexpr std::size_t symbol_count = 1'000;
+  constexpr std::size_t event_count = 4'000'000;
+  const ReplayStream stream = RecordedDay(symbol_count, event_count);
+
+  std::vector<std::size_t> thread_counts;
+  const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads < cores; threads *= 2)
+    thread_counts.push_back(threads);
+  thread_counts.push_back(cores);
+
+  std::cout << "Replay, " << symbol_count << " symbols, " << event_count << " events, " << cores << " cores" << std::endl;
+  double sequential_ns = 0;
+  std::size_t sequential_trades = 0;
+  for (std::size_t threads : thread_counts) {
+    SequencedTrades trades;
+    double ns = NanosecondsPerOp(event_count, [&] { trades = ReplayEngine{threads}.Run(stream); });
+    if (threads == 1) {
+      sequential_ns = ns;
+      sequential_trades = trades.size();
+    }
+    std::cout << "  " << threads << " threads: " << ns * event_count / 1e6 << " ms (" << ns << " ns/event), " << trades.size() << " trades, speedup "
+              << sequential_ns / ns << (trades.size() == sequential_trades ? "" : " MISMATCH") << std::endl;
+  }
+}
+
+void BenchTradeTape() {
+  constexpr std::size_t trade_count = 100'000'000;
+  constexpr uint64_t day_start = 34'200ull * 1'000'000'000; // 09:30
+  constexpr uint64_t day_length = 23'400ull * 1'000'000'000;
+  const std::string path = (std::filesystem::temp_directory_path() / "orderbook_bench.tape").string();
+  std::filesystem::remove(path);
+
+  std::mt19937_64 rng{42};
+  std::exponential_distribution<double> gap{static_cast<double>(trade_count) / day_length};
+  std::uniform_int_distribution<Price> step{-1, 1};
+  std::geometric_distribution<Quantity> lot{0.02};
+  std::uniform_int_distribution<OrderId> id_step{1, 64};
+  double ns = NanosecondsPerOp(trade_count, [&] {
+    TradeTapeWriter writer{path};
+    double timestamp = day_start;
+    Price price = 10'000;
+    OrderId buyer = 1, seller = 2;
+    for (std::size_t i = 0; i < trade_count; ++i) {
+      timestamp += gap(rng);
+      price += step(rng);
+      buyer += id_step(rng);
+      seller += id_step(rng);
+      writer.Append(static_cast<uint64_t>(timestamp), price, 1 + lot(rng), buyer, seller);
+    }
+  });
+  const auto bytes = std::filesystem::file_size(path);
+  std::cout << "Trade tape, " << trade_count << " trades over one session" << std::endl;
+  std::cout << "  append: " << ns << " ns/trade, " << static_cast<double>(bytes) / trade_count << " bytes/trade on disk" << std::endl;
+
+  TradeTapeReader reader{path};
+  TapeBar day{};
+  ns = NanosecondsPerOp(trade_count, [&] { day = reader.Summarize(0, UINT64_MAX); });
+  std::cout << "  full day vwap: " << ns * trade_count / 1e6 << " ms, " << reader.DecodedBlocks() << " of " << reader.BlockCount()
+            << " blocks decoded, vwap " << day.Vwap() << std::endl;
+  // an unaligned hour forces the edge blocks through the decoder
+  const uint64_t hour = 3'600ull * 1'000'000'000;
+  ns = NanosecondsPerOp(trade_count, [&] { day = reader.Summarize(day_start + hour + 12'345, day_start + 2 * hour + 12'345); });
+  std::cout << "  one hour vwap: " << ns * trade_count / 1e6 << " ms, " << reader.DecodedBlocks() << " blocks decoded, " << day.m_trade_count
+            << " trades" << std::endl;
+  TapeBars bars;
+  ns = NanosecondsPerOp(trade_count, [&] { bars = reader.Bars(day_start, day_start + day_length, 60ull * 1'000'000'000); });
+  std::cout << "  one minute bars: " << ns * trade_count / 1e6 << " ms (" << ns << " ns/trade), " << bars.size() << " bars, "
+            << reader.DecodedBlocks() << " blocks decoded" << std::endl;
+  // a block spans about a second here, so one second bars decode nearly every block: the full scan cost
+  ns = NanosecondsPerOp(trade_count, [&] { bars = reader.Bars(day_start, day_start + day_length, 1'000'000'000); });
+  std::cout << "  one second bars: " << ns * trade_count / 1e6 << " ms (" << ns << " ns/trade), " << bars.size() << " bars, "
+            << reader.DecodedBlocks() << " blocks decoded" << std::endl;
+  ns = NanosecondsPerOp(trade_count, [&] { bars = reader.Bars(day_start, day_start + day_length, hour / 2); });
+  std::cout << "  half hour bars: " << ns * trade_count / 1e6 << " ms, " << bars.size() << " bars, " << reader.DecodedBlocks()
+            << " blocks decoded" << std::endl;
+  std::filesystem::remove(path);
+}
+} // namespace
+
+// orderbook_bench [stp|layout|cancel|replay|tape|matching [budget ns/order]], no name runs everything
+int main(int argc, char **argv) {
+  const char *name = argc > 1 ? argv[1] : nullptr;
+  if (!name || !strcmp(name, "matching")) {
+    if (!BenchMatching(name && argc > 2 ? std::atof(argv[2]) : 0))
+      return 1;
+  }
+  if (!name || !strcmp(name, "stp"))
+    BenchSelfTradePrevention();
+  if (!name || !strcmp(name, "layout")) {
+    if (!BenchLayout(name && argc > 2 ? std::atof(argv[2]) : 0))
+      return 1;
+  }
+  if (!name || !strcmp(name, "cancel"))
+    BenchMassCancel();
+  if (!name || !strcmp(name, "replay"))
+    BenchReplay();
+  if (!name || !strcmp(name, "tape"))
+    BenchTradeTape();
+}
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "core/loadgen.h"
+#include "core/replay.h"
+
+using namespace OrderbookCore;
+
+namespace {
+// orderbook_cli --headless [--books N] [--seconds N] [--adds N] [--cancels N] [--modifies N] [--aggressive N], rates are per book
+int RunHeadless(int argc, char **argv) {
+  LoadProfile profile;
+  int books = 5; // one per symbol of the GUI
+  int seconds = 10;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--books"))
+      books = std::atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seconds"))
+      seconds = std::atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--adds"))
+      profile.m_add_rate = std::atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--cancels"))
+      profile.m_cancel_rate = std::atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--modifies"))
+      profile.m_modify_rate = std::atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--aggressive"))
+      profile.m_aggressive_rate = std::atof(argv[i + 1]);
+    else {
+      std::cerr << "unknown option " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+  if (books < 1) {
+    std::cerr << "--books must be at least 1" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<Orderbook>> orderbooks;
+  std::vector<Orderbook *> targets;
+  for (int i = 0; i < books; ++i) {
+    orderbooks.push_back(std::make_unique<Orderbook>());
+    targets.push_back(orderbooks.back().get());
+  }
+
+  LoadGenerator generator{targets, profile};
+  generator.Start();
+  for (int elapsed = 1; elapsed <= seconds; ++elapsed) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    LoadReport report = generator.GetReport();
+    std::cout << elapsed << "s target " << report.TargetRate() << "/s achieved " << report.AchievedRate() << "/s keep up "
+              << report.KeepUp() * 100 << "%" << std::endl;
+  }
+  generator.Stop();
+
+  LoadReport report = generator.GetReport();
+  for (std::size_t i = 0; i < orderbooks.size(); ++i) {
+    const auto &stats = orderbooks[i]->GetStats();
+    std::cout << "book " << i + 1 << ": " << stats.m_orders << " orders, " << stats.m_trades << " trades, " << stats.m_cancels
+              << " cancels, add p50/p99 " << stats.m_add_latency.Percentile(0.5) << "/" << stats.m_add_latency.Percentile(0.99) << " ns"
+              << std::endl;
+  }
+  return report.KeepUp() >= 0.99 ? 0 : 2;
+}
+
+// orderbook_cli --replay <recorded stream> <trade file> [--threads N]
+int RunReplay(int argc, char **argv) {
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0] << " --replay <recorded stream> <trade file> [--threads N]" << std::endl;
+    return 1;
+  }
+  std::size_t threads = std::thread::hardware_concurrency();
+  if (argc > 5 && !strcmp(argv[4], "--threads"))
+    threads = std::atoi(argv[5]);
+
+  std::ifstream in{argv[2]};
+  if (!in) {
+    std::cerr << "cannot open " << argv[2] << std::endl;
+    return 1;
+  }
+  std::ofstream out{argv[3]};
+  if (!out) {
+    std::cerr << "cannot open " << argv[3] << std::endl;
+    return 1;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  ReplayStream stream;
+  try {
+    stream = ReplayStream::Read(in);
+  } catch (const std::invalid_argument &err) {
+    std::cerr << argv[2] << ": " << err.what() << std::endl;
+    return 1;
+  }
+  SequencedTrades trades = ReplayEngine{threads}.Run(stream);
+  ReplayEngine::Write(out, stream, trades);
+  if (!out.flush()) {
+    std::cerr << "cannot write " << argv[3] << std::endl;
+    return 1;
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << stream.Size() << " events over " << stream.GetSymbols().size() << " symbols, " << trades.size() << " trades in " << elapsed << " s"
+            << std::endl;
+  return 0;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "--headless"))
+    return RunHeadless(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "--replay"))
+    return RunReplay(argc, argv);
+
+  std::cerr << "usage: " << argv[0] << " --headless [options] | --replay <recorded stream> <trade file> [--threads N]" << std::endl;
+  return 1;
+}
@@ -1,8 +1,13 @@
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "core/loadgen.h"
 #include "core/orderbook.h"
+#include "core/tape.h"
 
 namespace OrderbookApp {
   using namespace OrderbookCore;
@@ -13,6 +18,31 @@ namespace OrderbookApp {
     uint32_t Height = 800;
   };
 
+  // depth rows formatted once per book version, redrawn from here until the book changes
+  struct LadderRow {
+    char Quantity[16];
+    char Price[16];
+    bool Ask;
+  };
+
+  struct LadderCache {
+    uint64_t Version { UINT64_MAX };
+    std::vector<LadderRow> Rows;
+  };
+
+  // engine rates for one symbol, sampled from the book's lock free counters a few times a second
+  struct EngineHistory {
+    static constexpr int SampleCount = 120;
+    uint64_t Orders { 0 };
+    uint64_t Trades { 0 };
+    uint64_t Cancels { 0 };
+    std::chrono::steady_clock::time_point SampledAt {};
+    float OrderRates[SampleCount] {};
+    float TradeRates[SampleCount] {};
+    float CancelRates[SampleCount] {};
+    int Offset { 0 };
+  };
+
   class Application {
     public:
       Application(const ApplicationSpecification& app_spec = ApplicationSpecification());
@@ -24,11 +54,18 @@ namespace OrderbookApp {
     private:
       void Init();
       void Shutdown();
+      const LadderCache& GetLadder(const char* symbol);
+      void SampleEngineStats();
 
       ApplicationSpecification m_app_spec;
       GLFWwindow* m_window_handle { nullptr };
       bool m_running { false };
-      std::unordered_map<const char*, Orderbook*> m_orderbook_map;
+      std::unordered_map<const char*, std::unique_ptr<Orderbook>> m_orderbook_map;
+      std::unordered_map<const char*, LadderCache> m_ladder_cache;
+      std::unordered_map<const char*, EngineHistory> m_engine_history;
+      std::unique_ptr<LoadGenerator> m_load_generator;
+      // manual trades of each symbol, opened as "<symbol>.tape" on the first fill
+      std::unordered_map<const char*, std::unique_ptr<TradeTapeWriter>> m_trade_tapes;
       static inline const char* m_symbols[] { "apple", "netflix", "google", "meta", "morgan stanley" };
   };
 }
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook.h"
+
+namespace OrderbookCore {
+// target event rates per book, the generator paces them open loop so a slow engine shows up as falling behind
+struct LoadProfile {
+  double m_add_rate = 10'000;
+  double m_cancel_rate = 9'000;
+  double m_modify_rate = 2'000;
+  double m_aggressive_rate = 1'000;
+  Price m_start_price = 10'000;
+  double m_volatility = 0.05; // random walk step in ticks per event
+  Quantity m_mean_quantity = 100;
+};
+
+struct LoadReport {
+  double m_elapsed_seconds;
+  uint64_t m_target_operations;
+  uint64_t m_completed_operations;
+
+  double TargetRate() const { return m_elapsed_seconds > 0 ? m_target_operations / m_elapsed_seconds : 0; }
+  double AchievedRate() const { return m_elapsed_seconds > 0 ? m_completed_operations / m_elapsed_seconds : 0; }
+  // share of the target the engine kept up with, 1 means on schedule
+  double KeepUp() const { return m_target_operations ? static_cast<double>(m_completed_operations) / m_target_operations : 1; }
+};
+
+class LoadGenerator {
+public:
+  LoadGenerator(const std::vector<Orderbook *> &, const LoadProfile &profile = LoadProfile());
+  ~LoadGenerator();
+  void Start();
+  void Stop();
+  bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+  LoadReport GetReport() const;
+
+private:
+  struct LiveOrder {
+    OrderId m_order_id;
+    Side m_side;
+    Quantity m_remaining;
+  };
+  // orders the generator placed and has not seen fill or cancel. orders filled by someone else linger until picked
+  struct BookState {
+    Orderbook *m_orderbook;
+    double m_mid;
+    std::vector<LiveOrder> m_live_orders;
+    std::unordered_map<OrderId, std::size_t> m_live_index; // position in m_live_orders
+
+    void Track(OrderId, Side, Quantity);
+    void Untrack(std::size_t);
+    // drops live orders the trades filled
+    void Settle(const Trades &);
+  };
+  void Generate();
+
+  LoadProfile m_profile;
+  std::vector<BookState> m_books;
+  std::atomic<bool> m_running{false};
+  std::atomic<uint64_t> m_target_operations{0};
+  std::atomic<uint64_t> m_completed_operations{0};
+  std::atomic<std::chrono::steady_clock::rep> m_started_at{0};
+  std::atomic<std::chrono::steady_clock::rep> m_stopped_at{0};
+  std::thread m_thread;
+};
+}
@@ -2,6 +2,7 @@
 
 #include <list>
 #include <memory>
+#include <memory_resource>
 #include <vector>
 
 #include "types.h"
@@ -15,21 +16,36 @@ public:
   virtual Price GetPrice() const = 0;
   virtual Quantity GetInitialQuantity() const = 0;
   virtual Quantity GetRemainingQuantity() const = 0;
+  virtual Quantity GetDisplayedQuantity() const = 0;
+  virtual Price GetStopPrice() const = 0;
+  virtual ParticipantId GetParticipantId() const = 0;
+  virtual SelfTradePrevention GetSelfTradePrevention() const = 0;
   virtual bool IsFilled() const = 0;
+  // bytes of the concrete order object, the book reports them in its footprint
+  virtual std::size_t GetObjectSize() const = 0;
 
   virtual void Fill(Quantity) = 0;
   virtual void PriceAdjust(Price) = 0;
+  // shows the next clip of hidden quantity, returns how much became displayed
+  virtual Quantity Replenish() = 0;
+  // releases a stop order, it becomes a market order (stop) or a limit order (stop limit)
+  virtual void Trigger() = 0;
+  // participant 0 is anonymous and never checked for self trades
+  virtual void SetParticipant(ParticipantId, SelfTradePrevention) = 0;
 };
 
 using OrderIds = std::vector<OrderId>;
 using OrderPtr = std::shared_ptr<OrderInterface>;
-using OrderPtrs = std::list<OrderPtr>;
+using OrderPtrs = std::pmr::list<OrderPtr>;
 
 template <Side side> class GoodTillCancelOrder;
 template <Side side> class FillAndKillOrder;
 template <Side side> class FillOrKillOrder;
 template <Side side> class MarketOrder;
 template <Side side> class GoodForDayOrder;
+template <Side side> class IcebergOrder;
+template <Side side> class StopOrder;
+template <Side side> class StopLimitOrder;
 
 template <typename order_class, Side side> class Order : public OrderInterface {
 public:
@@ -42,10 +58,21 @@ public:
   Price GetPrice() const override { return m_price; }
   Quantity GetInitialQuantity() const override { return m_initial_quantity; }
   Quantity GetRemainingQuantity() const override { return m_remaining_quantity; }
+  Quantity GetDisplayedQuantity() const override { return m_remaining_quantity; }
+  Price GetStopPrice() const override { return 0; }
+  ParticipantId GetParticipantId() const override { return m_participant_id; }
+  SelfTradePrevention GetSelfTradePrevention() const override { return m_self_trade_prevention; }
   bool IsFilled() const override { return m_remaining_quantity == 0; }
+  std::size_t GetObjectSize() const override { return sizeof(order_class); }
 
   void Fill(Quantity) override;
   void PriceAdjust(Price) override;
+  Quantity Replenish() override { return 0; }
+  void Trigger() override;
+  void SetParticipant(ParticipantId participant_id, SelfTradePrevention self_trade_prevention) override {
+    m_participant_id = participant_id;
+    m_self_trade_prevention = self_trade_prevention;
+  }
 
 private:
   OrderType m_order_type = std::is_same<order_class, GoodTillCancelOrder<side>>() ? OrderType::GoodTillCancel
@@ -53,7 +80,12 @@ private:
                            : std::is_same<order_class, FillOrKillOrder<side>>()   ? OrderType::FillOrKill
                            : std::is_same<order_class, MarketOrder<side>>()       ? OrderType::Market
                            : std::is_same<order_class, GoodForDayOrder<side>>()   ? OrderType::GoodForDay
+                           : std::is_same<order_class, IcebergOrder<side>>()      ? OrderType::Iceberg
+                           : std::is_same<order_class, StopOrder<side>>()         ? OrderType::Stop
+                           : std::is_same<order_class, StopLimitOrder<side>>()    ? OrderType::StopLimit
                                                                                   : OrderType::Unknown;
+  SelfTradePrevention m_self_trade_prevention = SelfTradePrevention::None;
+  ParticipantId m_participant_id = 0;
   static constexpr Side m_side = side;
   OrderId m_order_id;
   Price m_price;
@@ -86,6 +118,45 @@ public:
   GoodForDayOrder(OrderId order_id, Price price, Quantity quantity) : Order<GoodForDayOrder<side>, side>(order_id, price, quantity) {}
 };
 
+template <Side side> class IcebergOrder : public Order<IcebergOrder<side>, side> {
+public:
+  IcebergOrder(OrderId order_id, Price price, Quantity quantity, Quantity display_quantity)
+      : Order<IcebergOrder<side>, side>(order_id, price, quantity),
+        m_display_quantity(display_quantity && display_quantity < quantity ? display_quantity : quantity), m_displayed_quantity(m_display_quantity) {}
+
+  Quantity GetDisplayedQuantity() const override { return m_displayed_quantity; }
+  Quantity GetDisplayQuantity() const { return m_display_quantity; }
+
+  void Fill(Quantity) override;
+  Quantity Replenish() override;
+
+private:
+  Quantity m_display_quantity;
+  Quantity m_displayed_quantity;
+};
+
+template <Side side> class StopOrder : public Order<StopOrder<side>, side> {
+public:
+  StopOrder(OrderId order_id, Price stop_price, Quantity quantity)
+      : Order<StopOrder<side>, side>(order_id, stop_price, quantity), m_stop_price(stop_price) {}
+
+  Price GetStopPrice() const override { return m_stop_price; }
+
+private:
+  Price m_stop_price;
+};
+
+template <Side side> class StopLimitOrder : public Order<StopLimitOrder<side>, side> {
+public:
+  StopLimitOrder(OrderId order_id, Price price, Quantity quantity, Price stop_price)
+      : Order<StopLimitOrder<side>, side>(order_id, price, quantity), m_stop_price(stop_price) {}
+
+  Price GetStopPrice() const override { return m_stop_price; }
+
+private:
+  Price m_stop_price;
+};
+
 template <typename order_class> class OrderModify {
 public:
   OrderModify(OrderId order_id, Price price, Quantity quantity) : m_order_id(order_id), m_price(price), m_quantity(quantity) {}
@@ -103,6 +174,9 @@ private:
 
 class OrderFactory {
 public:
-  static OrderPtr CreateOrder(const char *side, const char *type, Quantity quantity, Price price);
+  static OrderPtr CreateOrder(const char *side, const char *type, Quantity quantity, Price price, Quantity display_quantity = 0, Price stop_price = 0);
+  // keeps a recorded id, replay must reproduce the ids of the original run
+  static OrderPtr CreateOrder(OrderId order_id, const char *side, const char *type, Quantity quantity, Price price, Quantity display_quantity = 0,
+                              Price stop_price = 0);
 };
 }
@@ -1,49 +1,189 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <condition_variable>
 #include <map>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <unordered_map>
 
 #include "levelinfo.h"
 #include "order.h"
+#include "stats.h"
 #include "trade.h"
 
 namespace OrderbookCore {
+// sizing hint given at construction, lets the book reserve its index and node storage up front
+struct OrderbookConfig {
+  std::size_t m_expected_orders = 0;
+  Price m_min_price = 0;
+  Price m_max_price = 0;
+  // replay books turn this off, the wall clock must not cancel orders behind a deterministic run
+  bool m_prune_day_orders = true;
+  // participants expected to rest orders, reserves their index and a chain node for every expected order
+  std::size_t m_expected_participants = 0;
+};
+
+// bytes held by the book. the pool bytes are counted where the node pool draws from its upstream, so they include
+// nodes the pool keeps for reuse and its chunk bookkeeping. the per container split estimates live nodes from
+// libstdc++ node layouts, orders are allocated by the caller and sized by their concrete type
+struct MemoryFootprint {
+  std::size_t m_pool_bytes;     // measured, every map, list and hash node plus the bucket arrays
+  std::size_t m_level_bytes;    // estimated std::map nodes of both sides and of the stops
+  std::size_t m_queue_bytes;    // estimated std::list nodes of the level queues
+  std::size_t m_index_bytes;    // estimated id index and participant chains
+  std::size_t m_order_bytes;    // order objects and their shared_ptr control blocks
+  std::size_t m_reserved_bytes; // pool bytes drawn at construction for the config
+  std::size_t m_order_count;
+
+  std::size_t Total() const { return m_pool_bytes + m_order_bytes; }
+  std::size_t PerOrder() const { return m_order_count ? Total() / m_order_count : 0; }
+};
+
 class Orderbook {
 public:
-  Orderbook();
+  Orderbook(const OrderbookConfig &config = OrderbookConfig());
   ~Orderbook();
   Trades AddOrder(const OrderPtr &);
   void CancelOrder(OrderId);
   void CancelOrders(const OrderIds &);
+  // mass cancels run under a single lock. side and price range drop whole resting levels, pending stops are left alone.
+  // participant walks that participant's order chain and also cancels its pending stops
+  void CancelOrders(Side);
+  void CancelOrders(Side, Price low, Price high);
+  void CancelParticipantOrders(ParticipantId);
   template <typename order_class> Trades ModifyOrder(OrderModify<order_class>);
   // OrderbookLevelInfos GetLevelInfos() const;
   LevelInfoss GetLevelInfos() const;
+  // orders accumulate without matching until Uncross executes them at a single equilibrium price
+  void BeginAuction();
+  Trades Uncross();
+  TradingPhase GetTradingPhase() const { return m_phase.load(std::memory_order_acquire); }
 
-  std::size_t Size() const { return m_orders.size(); }
+  std::size_t Size() const { return m_stats.m_resting_orders.load(std::memory_order_relaxed); }
+  // advances after every call that can change the book, readers poll it without taking the lock
+  uint64_t GetVersion() const { return m_version.load(std::memory_order_acquire); }
+  MemoryFootprint GetMemoryFootprint() const;
+  // engine counters, safe to read from any thread while the book is trading
+  const OrderbookStats &GetStats() const { return m_stats; }
   void Print() const;
 
 private:
+  using ParticipantOrders = std::pmr::list<OrderId>;
   struct OrderEntry {
     OrderPtr m_order{nullptr};
     OrderPtrs::iterator m_pos;
+    // unordered_map nodes are stable, so the chain is reached without hashing the participant again
+    ParticipantOrders *m_chain{nullptr};
+    ParticipantOrders::iterator m_chain_pos;
+    // stamped from the book's arrival counter, self trade prevention compares it instead of caller chosen ids
+    uint64_t m_arrival{0};
+  };
+  // the match loop reads the key, the quantities and the queue head of the best level, they sit together right after
+  // the tree links. the queue takes its resource explicitly so its nodes stay on the shared pool, not on whole lines
+  struct Level {
+    explicit Level(std::pmr::memory_resource *resource) : m_orders(resource) {}
+
+    Quantity m_quantity{0};
+    Quantity m_hidden_quantity{0}; // iceberg reserve, excluded from the published depth
+    OrderPtrs m_orders;
+  };
+  // rounds every block up to whole cache lines, a level node then starts a line and its hot fields never straddle two
+  class CacheLineResource : public std::pmr::memory_resource {
+  public:
+    explicit CacheLineResource(std::pmr::memory_resource *upstream) : m_upstream(upstream) {}
+    static std::size_t RoundUp(std::size_t bytes) { return (bytes + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize; }
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+      return m_upstream->allocate(RoundUp(bytes), std::max(alignment, kCacheLineSize));
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+      m_upstream->deallocate(p, RoundUp(bytes), std::max(alignment, kCacheLineSize));
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource *m_upstream;
+  };
+  // counts what the node pool draws from its upstream
+  class CountingResource : public std::pmr::memory_resource {
+  public:
+    explicit CountingResource(std::pmr::memory_resource *upstream) : m_upstream(upstream) {}
+    std::size_t GetBytes() const { return m_bytes; }
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+      void *p = m_upstream->allocate(bytes, alignment);
+      m_bytes += bytes;
+      return p;
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+      m_upstream->deallocate(p, bytes, alignment);
+      m_bytes -= bytes;
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource *m_upstream;
+    std::size_t m_bytes{0};
   };
+  // one side's tree node as handed out by the level resource
+  static const std::size_t kLevelNodeBytes;
+  // draws the nodes the config expects through the pool and hands them back, the session then reuses them
+  void Reserve(const OrderbookConfig &);
+  // called by every mutating entry point before it releases the book mutex
+  void PublishChange();
+  template <typename Cancel> void TimedCancel(Cancel &&);
+  Trades AddOrderInternal(const OrderPtr &);
+  void InsertOrderEntry(const OrderPtr &, OrderPtrs::iterator);
+  void EraseOrderEntry(std::pmr::unordered_map<OrderId, OrderEntry>::iterator);
+  template <typename Levels> void CancelLevels(Levels &, typename Levels::iterator, typename Levels::iterator);
   void CancelOrderInternal(OrderId);
+  // the price executing the most volume, nullopt while the book does not cross
+  std::optional<Price> UncrossPrice() const;
+  bool StopTriggered(Side, Price) const;
+  void ReleaseStopOrders(Trades &);
   bool MatchPrice(Side, Price) const;
-  bool MatchQuantity(Side, Price, Quantity) const;
-  Trades MatchOrders();
+  // liquidity a fill or kill order can trade against, its own resting orders count only as far as its prevention mode fills them
+  bool MatchQuantity(const OrderInterface &) const;
+  Trades MatchOrders(std::optional<Price> uncross_price = std::nullopt);
+  void RemoveFront(Level &);
+  void ReplenishFront(Level &);
   void PruneDayOrders();
 
+  // members are grouped by who touches them, each group starts its own cache line so the prune thread, readers
+  // polling the counters and the match loop never dirty each other's lines
+
+  // control state, touched at construction, shutdown and once a day by the prune thread
   std::atomic<bool> m_closed{false};
   std::condition_variable m_closed_cv;
-  std::mutex mutable m_order_mutex;
   std::thread m_prune_thread;
+  // behind the node pool, only touched when the pool needs a fresh chunk
+  CountingResource m_pool_upstream;
+  std::size_t m_reserved_bytes{0};
+
+  // taken by every entry point and by the prune thread
+  alignas(kCacheLineSize) std::mutex mutable m_order_mutex;
+
+  // written by the book, read lock free by other threads
+  alignas(kCacheLineSize) std::atomic<uint64_t> m_version{0};
+  OrderbookStats m_stats;
 
-  std::map<Price, OrderPtrs, std::less<Price>> m_asks;
-  std::map<Price, OrderPtrs, std::greater<Price>> m_bids;
-  std::unordered_map<OrderId, OrderEntry> m_orders;
+  // matching state, only touched under the mutex. node storage comes first so it outlives the containers
+  alignas(kCacheLineSize) std::atomic<TradingPhase> m_phase{TradingPhase::Continuous};
+  std::optional<Price> m_last_trade_price;
+  uint64_t m_arrivals{0};
+  std::pmr::unsynchronized_pool_resource m_node_resource;
+  CacheLineResource m_level_resource;
+  std::pmr::map<Price, Level, std::less<Price>> m_asks;
+  std::pmr::map<Price, Level, std::greater<Price>> m_bids;
+  std::pmr::unordered_map<OrderId, OrderEntry> m_orders;
+  // pending stops keyed by stop price, ordered so the next one to trigger sits at the front
+  std::pmr::map<Price, OrderPtrs, std::less<Price>> m_buy_stops;
+  std::pmr::map<Price, OrderPtrs, std::greater<Price>> m_sell_stops;
+  std::pmr::unordered_map<ParticipantId, ParticipantOrders> m_participant_orders;
 };
 }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "orderbook.h"
+
+namespace OrderbookCore {
+enum class ReplayAction : uint8_t {
+  Add,
+  Cancel,
+  Modify,
+};
+
+// one line of a recorded stream, fields are whitespace separated
+//   <sequence> <symbol> A <Buy|Sell> <GTC|FAK|FOK|M|GFD|ICE|STP|STPL> <order id> <price> <quantity> [display quantity] [stop price]
+//   <sequence> <symbol> C <order id>
+//   <sequence> <symbol> M <order id> <Buy|Sell> <price> <quantity>
+struct ReplayEvent {
+  uint64_t m_sequence;
+  ReplayAction m_action;
+  Side m_side;
+  const char *m_type; // one of OrderTypeItems, as the factory expects
+  OrderId m_order_id;
+  Price m_price;
+  Quantity m_quantity;
+  Quantity m_display_quantity;
+  Price m_stop_price;
+};
+
+// a recorded stream partitioned by symbol, each symbol keeps its events in input order
+class ReplayStream {
+public:
+  static ReplayStream Read(std::istream &);
+  void Append(const std::string &symbol, const ReplayEvent &);
+
+  const std::vector<std::string> &GetSymbols() const { return m_symbols; }
+  const std::vector<ReplayEvent> &GetEvents(std::size_t symbol) const { return m_events[symbol]; }
+  std::size_t Size() const { return m_size; }
+
+private:
+  std::vector<std::string> m_symbols;
+  std::vector<std::vector<ReplayEvent>> m_events; // indexed like m_symbols
+  std::unordered_map<std::string, std::size_t> m_symbol_index;
+  std::size_t m_size{0};
+};
+
+struct SequencedTrade {
+  uint64_t m_sequence;       // position in the merged output
+  uint64_t m_input_sequence; // event that produced the trade
+  std::size_t m_symbol;      // index into ReplayStream::GetSymbols
+  Trade m_trade;
+};
+
+using SequencedTrades = std::vector<SequencedTrade>;
+
+// replays every symbol on its own book over a work stealing pool. books share nothing, so any schedule yields the trades
+// of a sequential run, and the merge orders them by input sequence
+class ReplayEngine {
+public:
+  explicit ReplayEngine(std::size_t thread_count = std::thread::hardware_concurrency());
+  SequencedTrades Run(const ReplayStream &) const;
+  // <sequence> <input sequence> <symbol> <bid id> <bid price> <bid quantity> <ask id> <ask price> <ask quantity>
+  static void Write(std::ostream &, const ReplayStream &, const SequencedTrades &);
+
+private:
+  std::size_t m_thread_count;
+};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace OrderbookCore {
+// latency counts in power of two nanosecond buckets. one writer (the book, under its mutex) and any number of readers,
+// so updates are plain relaxed stores and readers never block the engine
+class LatencyHistogram {
+public:
+  static constexpr std::size_t kBucketCount = 40;
+
+  void Record(uint64_t nanoseconds);
+  uint64_t Count() const;
+  // upper bound of the bucket holding the given fraction (0.5 = median) of the samples
+  uint64_t Percentile(double) const;
+
+private:
+  std::array<std::atomic<uint64_t>, kBucketCount> m_buckets{};
+};
+
+struct OrderbookStats {
+  std::atomic<uint64_t> m_orders{0};
+  std::atomic<uint64_t> m_trades{0};
+  std::atomic<uint64_t> m_cancels{0};
+  std::atomic<uint64_t> m_resting_orders{0};
+  std::atomic<uint64_t> m_ask_levels{0};
+  std::atomic<uint64_t> m_bid_levels{0};
+  LatencyHistogram m_add_latency;
+  LatencyHistogram m_cancel_latency;
+};
+
+// single writer increment, cheaper than a locked read-modify-write
+inline void Increment(std::atomic<uint64_t> &counter, uint64_t amount = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "trade.h"
+
+namespace OrderbookCore {
+// append only columnar trade tape. trades are cut into blocks of kBlockTrades rows, each column of a block is varint
+// encoded on its own (timestamps and ids as deltas, prices as zigzag deltas), and every block leads with a header
+// holding its time and price range plus the aggregates a scan needs when the whole block falls inside a query
+struct TapeBlockHeader {
+  uint32_t m_trade_count;
+  uint32_t m_column_bytes[5]; // timestamp, price, quantity, buyer, seller
+  uint64_t m_min_timestamp;
+  uint64_t m_max_timestamp;
+  Price m_min_price;
+  Price m_max_price;
+  Price m_open;
+  Price m_close;
+  uint64_t m_volume;
+  int64_t m_notional;
+};
+
+// one ohlc bar, also the result of a range summary
+struct TapeBar {
+  uint64_t m_start;
+  uint64_t m_trade_count;
+  uint64_t m_volume;
+  int64_t m_notional;
+  Price m_open;
+  Price m_high;
+  Price m_low;
+  Price m_close;
+
+  double Vwap() const { return m_volume ? static_cast<double>(m_notional) / m_volume : 0; }
+};
+
+using TapeBars = std::vector<TapeBar>;
+
+class TradeTapeWriter {
+public:
+  static constexpr std::size_t kBlockTrades = 4096;
+
+  // appends to an existing tape after cutting off a torn last block, timestamps must not go backwards across sessions either
+  explicit TradeTapeWriter(const std::string &path);
+  ~TradeTapeWriter();
+  uint64_t GetLastTimestamp() const { return m_last_timestamp; }
+  void Append(uint64_t timestamp, Price, Quantity, OrderId buyer, OrderId seller);
+  // the resting side sets the execution price, as for the book's last trade price
+  void Append(uint64_t timestamp, const Trades &, Side aggressor);
+  // writes the open block, a partial block stays a valid block of the tape
+  void Flush();
+
+private:
+  std::ofstream m_out;
+  TapeBlockHeader m_header{};
+  std::vector<uint8_t> m_columns[5];
+  uint64_t m_last_timestamp{0};
+  Price m_last_price{0};
+  OrderId m_last_buyer{0};
+  OrderId m_last_seller{0};
+};
+
+class TradeTapeReader {
+public:
+  // loads the block headers only, payloads are read per query
+  explicit TradeTapeReader(const std::string &path);
+  std::size_t Size() const { return m_trade_count; }
+  std::size_t BlockCount() const { return m_blocks.size(); }
+  // trades with from <= timestamp < to. blocks outside the range are skipped, blocks inside it are answered from their header
+  TapeBar Summarize(uint64_t from, uint64_t to) const;
+  // bars of the given width starting at from, bars without trades are left out
+  TapeBars Bars(uint64_t from, uint64_t to, uint64_t width) const;
+  // blocks whose payload had to be decoded by the last query
+  std::size_t DecodedBlocks() const { return m_decoded_blocks; }
+
+private:
+  struct Block {
+    TapeBlockHeader m_header;
+    std::streamoff m_offset;
+  };
+  template <typename Visit> void Scan(const Block &, uint64_t from, uint64_t to, Visit &&) const;
+
+  mutable std::ifstream m_in;
+  mutable std::vector<uint8_t> m_buffer;
+  mutable std::size_t m_decoded_blocks{0};
+  std::vector<Block> m_blocks;
+  std::size_t m_trade_count{0};
+};
+}
@@ -1,19 +1,27 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
 
 namespace OrderbookCore {
+// fixed rather than std::hardware_destructive_interference_size, which may differ between translation units
+inline constexpr std::size_t kCacheLineSize = 64;
+
 using Price = int32_t;
 using Quantity = uint32_t;
 using OrderId = uint64_t;
+using ParticipantId = uint32_t;
 
 enum class OrderType : uint8_t {
   GoodTillCancel,
   FillAndKill,
   FillOrKill,
   Market,
+  Iceberg,
+  Stop,
+  StopLimit,
   GoodForDay = 10,
   Unknown = 100,
 };
@@ -23,10 +31,13 @@ inline const std::unordered_map<OrderType, std::string> OrderTypeMap = {
     {OrderType::FillAndKill, "Fill And Kill"},
     {OrderType::FillOrKill, "Fill Or Kill"},
     {OrderType::Market, "Market"},
+    {OrderType::Iceberg, "Iceberg"},
+    {OrderType::Stop, "Stop"},
+    {OrderType::StopLimit, "Stop Limit"},
     {OrderType::GoodForDay, "Good For Day"},
 };
 
-inline const char* OrderTypeItems[] = { "GTC", "FAK", "FOK", "M", "GFD" };
+inline const char* OrderTypeItems[] = { "GTC", "FAK", "FOK", "M", "GFD", "ICE", "STP", "STPL" };
 
 enum class Side : uint8_t {
   Buy = 0,
@@ -36,4 +47,18 @@ enum class Side : uint8_t {
 };
 
 inline const char* SideItems[] = { "Buy", "Sell" };
+
+// applied when both sides of a fill belong to the same participant, the newer order's mode decides
+enum class SelfTradePrevention : uint8_t {
+  None,
+  CancelNewest,
+  CancelOldest,
+  CancelBoth,
+  Decrement,
+};
+
+enum class TradingPhase : uint8_t {
+  Continuous,
+  Auction,
+};
 }
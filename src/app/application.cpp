@@ -11,6 +11,8 @@
 #elif defined (__APPLE__) && defined(__MACH__)
 #define OS_MACOS
 #endif
+#include <algorithm>
+#include <cstdio>
 #include <stdexcept>
 
 #include "app/imgui_util.h"
@@ -22,7 +24,7 @@ namespace OrderbookApp {
 Application::Application(const ApplicationSpecification &app_spec) : m_app_spec(app_spec) {
   s_instance = this;
   for (auto symbol : m_symbols) {
-    m_orderbook_map.try_emplace(symbol, new Orderbook());
+    m_orderbook_map.try_emplace(symbol, std::make_unique<Orderbook>());
   }
   Init();
 }
@@ -61,8 +63,60 @@ void Application::Shutdown() {
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
 
-  for (auto& [_, orderbook] : m_orderbook_map) {
-    delete orderbook;
+  m_load_generator.reset();
+  m_trade_tapes.clear();
+  m_orderbook_map.clear();
+}
+
+const LadderCache& Application::GetLadder(const char* symbol) {
+  auto& ladder = m_ladder_cache[symbol];
+  auto& orderbook = m_orderbook_map[symbol];
+  // read the version before the levels, a change in between only costs one extra refresh next frame
+  uint64_t version = orderbook->GetVersion();
+  if (version == ladder.Version)
+    return ladder;
+
+  auto [asks, bids] = orderbook->GetLevelInfos();
+  ladder.Version = version;
+  ladder.Rows.resize(asks.size() + bids.size());
+  auto row = ladder.Rows.begin();
+  for (auto& ask_level : asks) {
+    snprintf(row->Quantity, sizeof(row->Quantity), "%u", ask_level.m_quantity);
+    snprintf(row->Price, sizeof(row->Price), "%d", ask_level.m_price);
+    row->Ask = true;
+    ++row;
+  }
+  for (auto& bid_level : bids) {
+    snprintf(row->Quantity, sizeof(row->Quantity), "%u", bid_level.m_quantity);
+    snprintf(row->Price, sizeof(row->Price), "%d", bid_level.m_price);
+    row->Ask = false;
+    ++row;
+  }
+  return ladder;
+}
+
+void Application::SampleEngineStats() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto symbol : m_symbols) {
+    auto& history = m_engine_history[symbol];
+    float elapsed = std::chrono::duration<float>(now - history.SampledAt).count();
+    if (elapsed < 0.25f) continue;
+
+    const auto& stats = m_orderbook_map[symbol]->GetStats();
+    uint64_t orders = stats.m_orders.load(std::memory_order_relaxed);
+    uint64_t trades = stats.m_trades.load(std::memory_order_relaxed);
+    uint64_t cancels = stats.m_cancels.load(std::memory_order_relaxed);
+    // the first sample only sets the baseline
+    if (history.SampledAt != std::chrono::steady_clock::time_point {}) {
+      history.OrderRates[history.Offset] = (orders - history.Orders) / elapsed;
+      history.TradeRates[history.Offset] = (trades - history.Trades) / elapsed;
+      history.CancelRates[history.Offset] = (cancels - history.Cancels) / elapsed;
+      history.Offset = (history.Offset + 1) % EngineHistory::SampleCount;
+    }
+    history.Orders = orders;
+    history.Trades = trades;
+    history.Cancels = cancels;
+    history.SampledAt = now;
   }
 }
 
@@ -142,11 +196,21 @@ void Application::Run() {
       ImGui::InputText("Order Price", current_order_price_input, sizeof(current_order_price_input), ImGuiInputTextFlags_CharsDecimal | ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_EscapeClearsAll);
       ImGui::NewLine();
 
+      static char current_order_display_input[10] = {'0', };
+      ImGui::InputText("Display Quantity (ICE)", current_order_display_input, sizeof(current_order_display_input), ImGuiInputTextFlags_CharsDecimal | ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_EscapeClearsAll);
+      ImGui::NewLine();
+
+      static char current_order_stop_input[10] = {'0', };
+      ImGui::InputText("Stop Price (STP, STPL)", current_order_stop_input, sizeof(current_order_stop_input), ImGuiInputTextFlags_CharsDecimal | ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_EscapeClearsAll);
+      ImGui::NewLine();
+
       if (ImGui::Button("Submit Order!")) {
         bool input_valid = current_order_symbol && current_order_side && current_order_type;
         try {
           int current_order_price = std::stoi(current_order_price_input);
           int current_order_quantity = std::stoi(current_order_quantity_input);
+          std::stoi(current_order_display_input);
+          std::stoi(current_order_stop_input);
           if (!current_order_price || !current_order_quantity) input_valid = false;
         } catch (const std::invalid_argument& err) {
           input_valid = false;
@@ -155,7 +219,16 @@ void Application::Run() {
         if (!input_valid) {
           ImGui::OpenPopup("invalid_input");
         } else {
-          m_orderbook_map[current_order_symbol]->AddOrder(OrderFactory::CreateOrder(current_order_side, current_order_type, std::stoi(current_order_quantity_input), std::stoi(current_order_price_input)));
+          OrderPtr order = OrderFactory::CreateOrder(current_order_side, current_order_type, std::stoi(current_order_quantity_input), std::stoi(current_order_price_input), std::stoi(current_order_display_input), std::stoi(current_order_stop_input));
+          Trades trades = m_orderbook_map[current_order_symbol]->AddOrder(order);
+          if (!trades.empty()) {
+            auto& tape = m_trade_tapes[current_order_symbol];
+            if (!tape) tape = std::make_unique<TradeTapeWriter>(std::string(current_order_symbol) + ".tape");
+            // the wall clock can step back, the tape only accepts time moving forward
+            const auto now = std::chrono::system_clock::now().time_since_epoch();
+            const uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+            tape->Append(std::max(timestamp, tape->GetLastTimestamp()), trades, order->GetSide());
+          }
           current_symbol = current_order_symbol;
           current_order_symbol = nullptr;
           current_order_side = nullptr;
@@ -164,6 +237,10 @@ void Application::Run() {
           current_order_quantity_input[0] = '0';
           memset(current_order_price_input, 0, sizeof(current_order_price_input));
           current_order_price_input[0] = '0';
+          memset(current_order_display_input, 0, sizeof(current_order_display_input));
+          current_order_display_input[0] = '0';
+          memset(current_order_stop_input, 0, sizeof(current_order_stop_input));
+          current_order_stop_input[0] = '0';
           ImGui::OpenPopup("order_received");
         }
       }
@@ -213,37 +290,91 @@ void Application::Run() {
       }
       ImGui::NewLine();
 
-      if (current_preview_symbol && ImGui::BeginTable("Orderbook Preview", 3)) {
-        ImGui::TableNextRow();
-        ImGui::TableNextColumn();
-        ImGui::Text("Asks");
-        ImGui::TableNextColumn();
-        ImGui::Text("Price");
-        ImGui::TableNextColumn();
-        ImGui::Text("Bids");
-
-        auto [asks, bids] = m_orderbook_map[current_preview_symbol]->GetLevelInfos();
-        for (auto& ask_level : asks) {
-          ImGui::TableNextRow();
-          ImGui::TableNextColumn();
-          ImGui::Text("%d", ask_level.m_quantity);
-          ImGui::TableNextColumn();
-          ImGui::Text("%d", ask_level.m_price);
-          ImGui::TableNextColumn();
-        }
-        for (auto& bid_level : bids) {
-          ImGui::TableNextRow();
-          ImGui::TableNextColumn();
-          ImGui::TableNextColumn();
-          ImGui::Text("%d", bid_level.m_price);
-          ImGui::TableNextColumn();
-          ImGui::Text("%d", bid_level.m_quantity);
+      if (current_preview_symbol && ImGui::BeginTable("Orderbook Preview", 3, ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Asks");
+        ImGui::TableSetupColumn("Price");
+        ImGui::TableSetupColumn("Bids");
+        ImGui::TableHeadersRow();
+
+        // only the visible rows are submitted, deep books cost the same as shallow ones
+        const auto& rows = GetLadder(current_preview_symbol).Rows;
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(rows.size()));
+        while (clipper.Step()) {
+          for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; ++n) {
+            const auto& row = rows[n];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (row.Ask) ImGui::TextUnformatted(row.Quantity);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(row.Price);
+            ImGui::TableNextColumn();
+            if (!row.Ask) ImGui::TextUnformatted(row.Quantity);
+          }
         }
         ImGui::EndTable();
       }
       ImGui::End();
     }
 
+    {
+      ImGui::SetNextWindowPos(ImVec2(0, 400));
+      ImGui::SetNextWindowSize(ImVec2(400, 400));
+      ImGui::Begin("Engine");
+
+      static int load_rates[4] = {10000, 9000, 2000, 1000};
+      bool load_running = m_load_generator && m_load_generator->IsRunning();
+      if (ImGui::CollapsingHeader("Load Generator")) {
+        ImGui::InputInt("adds/s", &load_rates[0], 1000, 10000);
+        ImGui::InputInt("cancels/s", &load_rates[1], 1000, 10000);
+        ImGui::InputInt("modifies/s", &load_rates[2], 1000, 10000);
+        ImGui::InputInt("aggressive/s", &load_rates[3], 1000, 10000);
+        if (ImGui::Button(load_running ? "Stop Load" : "Start Load")) {
+          if (load_running) {
+            m_load_generator->Stop();
+          } else {
+            LoadProfile profile;
+            profile.m_add_rate = load_rates[0];
+            profile.m_cancel_rate = load_rates[1];
+            profile.m_modify_rate = load_rates[2];
+            profile.m_aggressive_rate = load_rates[3];
+            std::vector<Orderbook*> orderbooks;
+            for (auto symbol : m_symbols) orderbooks.push_back(m_orderbook_map[symbol].get());
+            m_load_generator = std::make_unique<LoadGenerator>(orderbooks, profile);
+            m_load_generator->Start();
+          }
+        }
+        if (m_load_generator) {
+          LoadReport report = m_load_generator->GetReport();
+          ImGui::SameLine();
+          ImGui::Text("target %.0f/s  achieved %.0f/s  keep up %.1f%%", report.TargetRate(), report.AchievedRate(), report.KeepUp() * 100);
+        }
+      }
+
+      SampleEngineStats();
+      for (auto symbol : m_symbols) {
+        if (!ImGui::CollapsingHeader(symbol)) continue;
+
+        ImGui::PushID(symbol);
+        const auto& stats = m_orderbook_map[symbol]->GetStats();
+        const auto& history = m_engine_history[symbol];
+        int latest = (history.Offset + EngineHistory::SampleCount - 1) % EngineHistory::SampleCount;
+        ImGui::Text("orders/s %.0f  trades/s %.0f  cancels/s %.0f", history.OrderRates[latest], history.TradeRates[latest], history.CancelRates[latest]);
+        ImGui::Text("resting %llu  levels %llu ask / %llu bid", (unsigned long long)stats.m_resting_orders.load(std::memory_order_relaxed),
+                    (unsigned long long)stats.m_ask_levels.load(std::memory_order_relaxed), (unsigned long long)stats.m_bid_levels.load(std::memory_order_relaxed));
+        ImGui::Text("add ns     p50 %llu  p99 %llu  p99.9 %llu", (unsigned long long)stats.m_add_latency.Percentile(0.5),
+                    (unsigned long long)stats.m_add_latency.Percentile(0.99), (unsigned long long)stats.m_add_latency.Percentile(0.999));
+        ImGui::Text("cancel ns  p50 %llu  p99 %llu  p99.9 %llu", (unsigned long long)stats.m_cancel_latency.Percentile(0.5),
+                    (unsigned long long)stats.m_cancel_latency.Percentile(0.99), (unsigned long long)stats.m_cancel_latency.Percentile(0.999));
+        ImGui::PlotLines("orders/s", history.OrderRates, EngineHistory::SampleCount, history.Offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+        ImGui::PlotLines("trades/s", history.TradeRates, EngineHistory::SampleCount, history.Offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+        ImGui::PlotLines("cancels/s", history.CancelRates, EngineHistory::SampleCount, history.Offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+        ImGui::PopID();
+      }
+      ImGui::End();
+    }
+
     // Rendering
     ImGui::Render();
     int display_w, display_h;
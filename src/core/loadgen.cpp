@@ -0,0 +1,162 @@
+#include "core/loadgen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace OrderbookCore {
+namespace {
+enum class Event : uint8_t {
+  Add,
+  Cancel,
+  Modify,
+  Aggressive,
+};
+
+using Clock = std::chrono::steady_clock;
+// keeps the walk far enough above zero that passive prices stay positive
+constexpr double kMinimumMid = 64;
+} // namespace
+
+LoadGenerator::LoadGenerator(const std::vector<Orderbook *> &orderbooks, const LoadProfile &profile) : m_profile(profile) {
+  for (auto orderbook : orderbooks)
+    m_books.push_back({orderbook, static_cast<double>(profile.m_start_price), {}, {}});
+}
+
+LoadGenerator::~LoadGenerator() { Stop(); }
+
+void LoadGenerator::Start() {
+  if (m_running.exchange(true, std::memory_order_acq_rel))
+    return;
+
+  m_target_operations.store(0, std::memory_order_relaxed);
+  m_completed_operations.store(0, std::memory_order_relaxed);
+  m_started_at.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+  m_stopped_at.store(0, std::memory_order_relaxed);
+  m_thread = std::thread{[this] { Generate(); }};
+}
+
+void LoadGenerator::Stop() {
+  if (!m_running.exchange(false, std::memory_order_acq_rel))
+    return;
+
+  m_thread.join();
+  m_stopped_at.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+LoadReport LoadGenerator::GetReport() const {
+  const auto started_at = m_started_at.load(std::memory_order_relaxed);
+  const auto stopped_at = m_stopped_at.load(std::memory_order_relaxed);
+  const auto now = stopped_at ? stopped_at : Clock::now().time_since_epoch().count();
+  return {started_at ? std::chrono::duration<double>(Clock::duration(now - started_at)).count() : 0,
+          m_target_operations.load(std::memory_order_relaxed), m_completed_operations.load(std::memory_order_relaxed)};
+}
+
+void LoadGenerator::BookState::Track(OrderId order_id, Side side, Quantity quantity) {
+  m_live_index[order_id] = m_live_orders.size();
+  m_live_orders.push_back({order_id, side, quantity});
+}
+
+void LoadGenerator::BookState::Untrack(std::size_t pos) {
+  m_live_index.erase(m_live_orders[pos].m_order_id);
+  if (pos != m_live_orders.size() - 1) {
+    m_live_orders[pos] = m_live_orders.back();
+    m_live_index[m_live_orders[pos].m_order_id] = pos;
+  }
+  m_live_orders.pop_back();
+}
+
+void LoadGenerator::BookState::Settle(const Trades &trades) {
+  for (const auto &trade : trades) {
+    for (const auto &side : {trade.GetBidTrade(), trade.GetAskTrade()}) {
+      auto iter = m_live_index.find(side.m_order_id);
+      if (iter == m_live_index.end())
+        continue;
+      auto &live = m_live_orders[iter->second];
+      live.m_remaining -= std::min(live.m_remaining, side.m_quantity);
+      if (!live.m_remaining)
+        Untrack(iter->second);
+    }
+  }
+}
+
+void LoadGenerator::Generate() {
+  const double book_rate = m_profile.m_add_rate + m_profile.m_cancel_rate + m_profile.m_modify_rate + m_profile.m_aggressive_rate;
+  const double total_rate = book_rate * m_books.size();
+  if (total_rate <= 0)
+    return;
+
+  std::mt19937_64 rng{std::random_device{}()};
+  std::discrete_distribution<int> event{m_profile.m_add_rate, m_profile.m_cancel_rate, m_profile.m_modify_rate, m_profile.m_aggressive_rate};
+  std::normal_distribution<double> step{0, m_profile.m_volatility};
+  // passive orders cluster near the touch, sizes have the long right tail of real flow
+  std::geometric_distribution<Price> depth{0.3};
+  std::lognormal_distribution<double> size{std::log(static_cast<double>(m_profile.m_mean_quantity)) - 0.5, 1.0};
+  std::bernoulli_distribution buy{0.5};
+
+  auto RandomQuantity = [&] { return std::max<Quantity>(1, static_cast<Quantity>(size(rng))); };
+  auto PassivePrice = [&](const BookState &book, Side side) {
+    const Price mid = static_cast<Price>(std::lround(book.m_mid));
+    return side == Side::Buy ? mid - 1 - depth(rng) : mid + 1 + depth(rng);
+  };
+
+  const auto start = Clock::time_point{Clock::duration{m_started_at.load(std::memory_order_relaxed)}};
+  uint64_t issued = 0;
+  std::size_t next_book = 0;
+  while (m_running.load(std::memory_order_acquire)) {
+    const uint64_t due = static_cast<uint64_t>(std::chrono::duration<double>(Clock::now() - start).count() * total_rate);
+    m_target_operations.store(due, std::memory_order_relaxed);
+    if (issued >= due) {
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((issued + 1) / total_rate)));
+      continue;
+    }
+
+    // bounded batches keep Stop responsive when the engine cannot keep up
+    for (int batch = 0; issued < due && batch < 1024; ++batch, ++issued) {
+      auto &book = m_books[next_book];
+      next_book = (next_book + 1) % m_books.size();
+      book.m_mid = std::max(book.m_mid + step(rng), kMinimumMid);
+
+      Event kind = static_cast<Event>(event(rng));
+      if ((kind == Event::Cancel || kind == Event::Modify) && book.m_live_orders.empty())
+        kind = Event::Add;
+
+      switch (kind) {
+      case Event::Add: {
+        const Side side = buy(rng) ? Side::Buy : Side::Sell;
+        OrderPtr order = OrderFactory::CreateOrder(SideItems[static_cast<int>(side)], "GTC", RandomQuantity(), PassivePrice(book, side));
+        book.Track(order->GetOrderId(), side, order->GetInitialQuantity());
+        book.Settle(book.m_orderbook->AddOrder(order));
+        break;
+      }
+      case Event::Cancel: {
+        std::uniform_int_distribution<std::size_t> pick{0, book.m_live_orders.size() - 1};
+        const std::size_t pos = pick(rng);
+        book.m_orderbook->CancelOrder(book.m_live_orders[pos].m_order_id);
+        book.Untrack(pos);
+        break;
+      }
+      case Event::Modify: {
+        std::uniform_int_distribution<std::size_t> pick{0, book.m_live_orders.size() - 1};
+        auto &live = book.m_live_orders[pick(rng)];
+        live.m_remaining = RandomQuantity();
+        const Price price = PassivePrice(book, live.m_side);
+        if (live.m_side == Side::Buy)
+          book.Settle(book.m_orderbook->ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>(live.m_order_id, price, live.m_remaining)));
+        else
+          book.Settle(book.m_orderbook->ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Sell>>(live.m_order_id, price, live.m_remaining)));
+        break;
+      }
+      case Event::Aggressive: {
+        const Side side = buy(rng) ? Side::Buy : Side::Sell;
+        const Price mid = static_cast<Price>(std::lround(book.m_mid));
+        book.Settle(book.m_orderbook->AddOrder(
+            OrderFactory::CreateOrder(SideItems[static_cast<int>(side)], "FAK", RandomQuantity(), side == Side::Buy ? mid + 3 : mid - 3)));
+        break;
+      }
+      }
+    }
+    m_completed_operations.store(issued, std::memory_order_relaxed);
+  }
+}
+}
@@ -1,5 +1,7 @@
 #include "core/order.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <stdexcept>
 
@@ -21,28 +23,70 @@ template <typename order_class, Side side> void Order<order_class, side>::PriceA
   m_price = price;
 }
 
+template <typename order_class, Side side> void Order<order_class, side>::Trigger() {
+  if (m_order_type == OrderType::Stop)
+    m_order_type = OrderType::Market;
+  else if (m_order_type == OrderType::StopLimit)
+    m_order_type = OrderType::GoodTillCancel;
+  else
+    throw std::logic_error("Only stop orders can be triggered");
+}
+
+template <Side side> void IcebergOrder<side>::Fill(Quantity quantity) {
+  if (quantity > m_displayed_quantity)
+    throw std::logic_error("Iceberg order cannot be filled more than its displayed quantity");
+
+  Order<IcebergOrder<side>, side>::Fill(quantity);
+  m_displayed_quantity -= quantity;
+}
+
+template <Side side> Quantity IcebergOrder<side>::Replenish() {
+  m_displayed_quantity = std::min(m_display_quantity, this->GetRemainingQuantity());
+  return m_displayed_quantity;
+}
+
 template <typename order_class> OrderPtr OrderModify<order_class>::Convert() const {
   return std::make_shared<order_class>(m_order_id, m_price, m_quantity);
 }
 
-OrderPtr OrderFactory::CreateOrder(const char *side, const char *type, Quantity quantity, Price price) {
-  static uint64_t order_id = 0;
+template class OrderModify<GoodTillCancelOrder<Side::Buy>>;
+template class OrderModify<GoodTillCancelOrder<Side::Sell>>;
+template class OrderModify<GoodForDayOrder<Side::Buy>>;
+template class OrderModify<GoodForDayOrder<Side::Sell>>;
+
+OrderPtr OrderFactory::CreateOrder(const char *side, const char *type, Quantity quantity, Price price, Quantity display_quantity, Price stop_price) {
+  // the gui and the load generator create orders from different threads
+  static std::atomic<uint64_t> order_id = 0;
+  return CreateOrder(++order_id, side, type, quantity, price, display_quantity, stop_price);
+}
+
+OrderPtr OrderFactory::CreateOrder(OrderId order_id, const char *side, const char *type, Quantity quantity, Price price, Quantity display_quantity,
+                                   Price stop_price) {
   switch (hash_strlit(type)) {
   case "GTC"_hash:
-    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Buy>>(++order_id, price, quantity))
-                                : static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Sell>>(++order_id, price, quantity));
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Buy>>(order_id, price, quantity))
+                                : static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Sell>>(order_id, price, quantity));
   case "FAK"_hash:
-    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<FillAndKillOrder<Side::Buy>>(++order_id, price, quantity))
-                                : static_cast<OrderPtr>(std::make_shared<FillAndKillOrder<Side::Sell>>(++order_id, price, quantity));
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<FillAndKillOrder<Side::Buy>>(order_id, price, quantity))
+                                : static_cast<OrderPtr>(std::make_shared<FillAndKillOrder<Side::Sell>>(order_id, price, quantity));
   case "FOK"_hash:
-    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<FillOrKillOrder<Side::Buy>>(++order_id, price, quantity))
-                                : static_cast<OrderPtr>(std::make_shared<FillOrKillOrder<Side::Sell>>(++order_id, price, quantity));
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<FillOrKillOrder<Side::Buy>>(order_id, price, quantity))
+                                : static_cast<OrderPtr>(std::make_shared<FillOrKillOrder<Side::Sell>>(order_id, price, quantity));
   case "M"_hash:
-    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<MarketOrder<Side::Buy>>(++order_id, price, quantity))
-                                : static_cast<OrderPtr>(std::make_shared<MarketOrder<Side::Sell>>(++order_id, price, quantity));
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<MarketOrder<Side::Buy>>(order_id, price, quantity))
+                                : static_cast<OrderPtr>(std::make_shared<MarketOrder<Side::Sell>>(order_id, price, quantity));
   case "GFD"_hash:
-    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<GoodForDayOrder<Side::Buy>>(++order_id, price, quantity))
-                                : static_cast<OrderPtr>(std::make_shared<GoodForDayOrder<Side::Sell>>(++order_id, price, quantity));
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<GoodForDayOrder<Side::Buy>>(order_id, price, quantity))
+                                : static_cast<OrderPtr>(std::make_shared<GoodForDayOrder<Side::Sell>>(order_id, price, quantity));
+  case "ICE"_hash:
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<IcebergOrder<Side::Buy>>(order_id, price, quantity, display_quantity))
+                                : static_cast<OrderPtr>(std::make_shared<IcebergOrder<Side::Sell>>(order_id, price, quantity, display_quantity));
+  case "STP"_hash:
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<StopOrder<Side::Buy>>(order_id, stop_price, quantity))
+                                : static_cast<OrderPtr>(std::make_shared<StopOrder<Side::Sell>>(order_id, stop_price, quantity));
+  case "STPL"_hash:
+    return !strcmp(side, "Buy") ? static_cast<OrderPtr>(std::make_shared<StopLimitOrder<Side::Buy>>(order_id, price, quantity, stop_price))
+                                : static_cast<OrderPtr>(std::make_shared<StopLimitOrder<Side::Sell>>(order_id, price, quantity, stop_price));
   default:
     return nullptr;
   }
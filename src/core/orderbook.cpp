@@ -3,22 +3,107 @@
 #include <algorithm>
 #include <chrono>
 #include <ctime>
-#include <numeric>
 // #include <iostream>
 
 namespace OrderbookCore {
-Orderbook::Orderbook() : m_prune_thread{[this] { PruneDayOrders(); }} {}
+namespace {
+constexpr std::size_t kTreeNodeBytes = 4 * sizeof(void *);
+constexpr std::size_t kListNodeBytes = 2 * sizeof(void *) + sizeof(OrderPtr);
+constexpr std::size_t kHashNodeBytes = sizeof(void *);
+// make_shared puts the order behind the control block's vtable pointer and its two counts
+constexpr std::size_t kControlBlockBytes = 2 * sizeof(void *);
+} // namespace
+
+const std::size_t Orderbook::kLevelNodeBytes = CacheLineResource::RoundUp(kTreeNodeBytes + sizeof(std::pair<const Price, Level>));
+
+Orderbook::Orderbook(const OrderbookConfig &config)
+    : m_pool_upstream(std::pmr::new_delete_resource()), m_node_resource(&m_pool_upstream), m_level_resource(&m_node_resource), m_asks(&m_level_resource), m_bids(&m_level_resource), m_orders(&m_node_resource),
+      m_buy_stops(&m_node_resource), m_sell_stops(&m_node_resource), m_participant_orders(&m_node_resource) {
+  // each member group starts its own cache line. offsetof on a non standard layout class is conditionally supported,
+  // gcc and clang give the real offset as long as there are no virtual bases
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+  static_assert(alignof(Orderbook) == kCacheLineSize, "the book must start a cache line for its groups to start one");
+  static_assert(offsetof(Orderbook, m_order_mutex) % kCacheLineSize == 0, "the mutex must start its own cache line");
+  static_assert(offsetof(Orderbook, m_version) % kCacheLineSize == 0, "the published counters must start their own cache line");
+  static_assert(offsetof(Orderbook, m_phase) % kCacheLineSize == 0, "the matching state must start its own cache line");
+#pragma GCC diagnostic pop
+  if (config.m_expected_orders)
+    Reserve(config);
+  if (config.m_prune_day_orders)
+    m_prune_thread = std::thread{[this] { PruneDayOrders(); }};
+}
+
+void Orderbook::Reserve(const OrderbookConfig &config) {
+  m_orders.reserve(config.m_expected_orders);
+  m_participant_orders.reserve(config.m_expected_participants);
+
+  // the pool never returns a block upstream, so nodes drawn through the real containers and freed stay on its free
+  // lists, chunk growth and bookkeeping included. they are all held at once, node types of one size class share
+  // blocks and would otherwise reuse each other's
+  {
+    OrderPtrs queue{&m_node_resource};
+    ParticipantOrders chain{&m_node_resource};
+    for (OrderId id = 1; id <= config.m_expected_orders; ++id) {
+      queue.emplace_back();
+      m_orders.try_emplace(id);
+      if (config.m_expected_participants)
+        chain.push_back(id);
+    }
+    for (ParticipantId id = 1; id <= config.m_expected_participants; ++id)
+      m_participant_orders.try_emplace(id);
+    // both sides' nodes come from one size class, a price rests on one side at a time
+    if (config.m_max_price >= config.m_min_price)
+      for (int64_t price = config.m_min_price; price <= config.m_max_price; ++price)
+        m_asks.try_emplace(static_cast<Price>(price), &m_node_resource);
+    m_orders.clear();
+    m_participant_orders.clear();
+    m_asks.clear();
+  }
+  m_reserved_bytes = m_pool_upstream.GetBytes();
+}
 
 Orderbook::~Orderbook() {
   m_closed.store(true, std::memory_order_release);
   m_closed_cv.notify_one();
-  m_prune_thread.join();
+  if (m_prune_thread.joinable())
+    m_prune_thread.join();
 }
 
 Trades Orderbook::AddOrder(const OrderPtr &order) {
+  std::scoped_lock l(m_order_mutex);
+  const auto start = std::chrono::steady_clock::now();
+  Trades trades = AddOrderInternal(order);
+  ReleaseStopOrders(trades);
+  Increment(m_stats.m_orders);
+  Increment(m_stats.m_trades, trades.size());
+  m_stats.m_add_latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  PublishChange();
+  return trades;
+}
+
+Trades Orderbook::AddOrderInternal(const OrderPtr &order) {
   if (m_orders.count(order->GetOrderId()))
     return {};
 
+  if (order->GetOrderType() == OrderType::Stop || order->GetOrderType() == OrderType::StopLimit) {
+    // an auction parks even a triggered stop, the uncross releases it once the book trades continuously again
+    if (m_phase.load(std::memory_order_relaxed) == TradingPhase::Auction || !StopTriggered(order->GetSide(), order->GetStopPrice())) {
+      auto &stops = order->GetSide() == Side::Buy ? m_buy_stops.try_emplace(order->GetStopPrice()).first->second
+                                                  : m_sell_stops.try_emplace(order->GetStopPrice()).first->second;
+      stops.push_back(order);
+      InsertOrderEntry(order, std::prev(stops.end()));
+      return {};
+    }
+    order->Trigger();
+  }
+
+  // an auction only collects priced interest, immediate orders have nothing to execute against yet
+  if (m_phase.load(std::memory_order_relaxed) == TradingPhase::Auction &&
+      (order->GetOrderType() == OrderType::Market || order->GetOrderType() == OrderType::FillAndKill ||
+       order->GetOrderType() == OrderType::FillOrKill))
+    return {};
+
   if (order->GetOrderType() == OrderType::Market) {
     if (order->GetSide() == Side::Buy && !m_asks.empty()) {
       const auto &[price, _] = *m_asks.rbegin();
@@ -34,44 +119,139 @@ Trades Orderbook::AddOrder(const OrderPtr &order) {
   if (order->GetOrderType() == OrderType::FillAndKill && !MatchPrice(order->GetSide(), order->GetPrice()))
     return {};
 
-  if (order->GetOrderType() == OrderType::FillOrKill && !MatchQuantity(order->GetSide(), order->GetPrice(), order->GetRemainingQuantity()))
+  if (order->GetOrderType() == OrderType::FillOrKill && !MatchQuantity(*order))
     return {};
 
-  OrderPtrs::iterator iter;
-  if (order->GetSide() == Side::Buy) {
-    auto &orders = m_bids[order->GetPrice()];
-    orders.push_back(order);
-    iter = std::prev(orders.end());
-  } else {
-    auto &orders = m_asks[order->GetPrice()];
-    orders.push_back(order);
-    iter = std::prev(orders.end());
-  }
-  m_orders[order->GetOrderId()] = {order, iter};
-  return MatchOrders();
+  auto &level = order->GetSide() == Side::Buy ? m_bids.try_emplace(order->GetPrice(), &m_node_resource).first->second
+                                               : m_asks.try_emplace(order->GetPrice(), &m_node_resource).first->second;
+  level.m_orders.push_back(order);
+  level.m_quantity += order->GetRemainingQuantity();
+  level.m_hidden_quantity += order->GetRemainingQuantity() - order->GetDisplayedQuantity();
+  InsertOrderEntry(order, std::prev(level.m_orders.end()));
+
+  if (m_phase.load(std::memory_order_relaxed) == TradingPhase::Auction)
+    return {};
+
+  Trades trades = MatchOrders();
+  // the resting side sets the execution price
+  if (!trades.empty())
+    m_last_trade_price = order->GetSide() == Side::Buy ? trades.back().GetAskTrade().m_price : trades.back().GetBidTrade().m_price;
+  return trades;
 }
 
-void Orderbook::CancelOrder(OrderId order_id) {
+template <typename Cancel> void Orderbook::TimedCancel(Cancel &&cancel) {
   std::scoped_lock l(m_order_mutex);
-  CancelOrderInternal(order_id);
+  const auto start = std::chrono::steady_clock::now();
+  const std::size_t resting_orders = m_orders.size();
+  cancel();
+  Increment(m_stats.m_cancels, resting_orders - m_orders.size());
+  m_stats.m_cancel_latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  PublishChange();
+}
+
+void Orderbook::CancelOrder(OrderId order_id) {
+  TimedCancel([&] { CancelOrderInternal(order_id); });
 }
 
 void Orderbook::CancelOrders(const OrderIds &order_ids) {
-  std::scoped_lock l(m_order_mutex);
-  for (OrderId id : order_ids) {
-    CancelOrderInternal(id);
+  TimedCancel([&] {
+    for (OrderId id : order_ids) {
+      CancelOrderInternal(id);
+    }
+  });
+}
+
+void Orderbook::CancelOrders(Side side) {
+  TimedCancel([&] {
+    if (side == Side::Buy)
+      CancelLevels(m_bids, m_bids.begin(), m_bids.end());
+    else
+      CancelLevels(m_asks, m_asks.begin(), m_asks.end());
+  });
+}
+
+void Orderbook::CancelOrders(Side side, Price low, Price high) {
+  if (low > high)
+    return;
+  TimedCancel([&] {
+    if (side == Side::Buy)
+      CancelLevels(m_bids, m_bids.lower_bound(high), m_bids.upper_bound(low));
+    else
+      CancelLevels(m_asks, m_asks.lower_bound(low), m_asks.upper_bound(high));
+  });
+}
+
+void Orderbook::CancelParticipantOrders(ParticipantId participant_id) {
+  TimedCancel([&] {
+    auto chain = m_participant_orders.find(participant_id);
+    if (chain == m_participant_orders.end())
+      return;
+
+    // every cancel unlinks the chain head, the emptied chain stays for the participant's next order
+    auto &order_ids = chain->second;
+    while (!order_ids.empty())
+      CancelOrderInternal(order_ids.front());
+  });
+}
+
+template <typename Levels> void Orderbook::CancelLevels(Levels &levels, typename Levels::iterator first, typename Levels::iterator last) {
+  // the levels go away whole, only the id index and participant chains are touched order by order
+  for (auto level = first; level != last; ++level) {
+    for (const auto &order : level->second.m_orders)
+      EraseOrderEntry(m_orders.find(order->GetOrderId()));
   }
+  levels.erase(first, last);
 }
 
 template <typename order_class>
 Trades Orderbook::ModifyOrder(OrderModify<order_class> order) {
-  auto iter = m_orders.find(order.GetOrderId());
-  if (iter == m_orders.end())
+  std::scoped_lock l(m_order_mutex);
+  if (!m_orders.count(order.GetOrderId()))
     return {};
 
-  const auto &[order_ptr, _] = iter->second;
-  CancelOrder(order_ptr->GetOrderId());
-  return AddOrder(order.template Convert<order_class>());
+  // cancel and re-add under one lock, nobody can observe the order missing in between. the replacement keeps the
+  // owner and prevention mode, so it stays in the participant's chain and is still checked for self trades
+  const auto start = std::chrono::steady_clock::now();
+  OrderPtr modified = order.Convert();
+  const OrderPtr &existing = m_orders.find(order.GetOrderId())->second.m_order;
+  modified->SetParticipant(existing->GetParticipantId(), existing->GetSelfTradePrevention());
+  CancelOrderInternal(order.GetOrderId());
+  Trades trades = AddOrderInternal(modified);
+  ReleaseStopOrders(trades);
+  Increment(m_stats.m_orders);
+  Increment(m_stats.m_trades, trades.size());
+  m_stats.m_add_latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  PublishChange();
+  return trades;
+}
+
+template Trades Orderbook::ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>);
+template Trades Orderbook::ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Sell>>);
+template Trades Orderbook::ModifyOrder(OrderModify<GoodForDayOrder<Side::Buy>>);
+template Trades Orderbook::ModifyOrder(OrderModify<GoodForDayOrder<Side::Sell>>);
+
+void Orderbook::InsertOrderEntry(const OrderPtr &order, OrderPtrs::iterator pos) {
+  OrderEntry &entry = m_orders[order->GetOrderId()];
+  entry = {order, pos};
+  entry.m_arrival = ++m_arrivals;
+  if (order->GetParticipantId()) {
+    entry.m_chain = &m_participant_orders.try_emplace(order->GetParticipantId()).first->second;
+    entry.m_chain_pos = entry.m_chain->insert(entry.m_chain->end(), order->GetOrderId());
+  }
+}
+
+void Orderbook::EraseOrderEntry(std::pmr::unordered_map<OrderId, OrderEntry>::iterator iter) {
+  if (iter->second.m_chain)
+    iter->second.m_chain->erase(iter->second.m_chain_pos);
+  m_orders.erase(iter);
+}
+
+void Orderbook::PublishChange() {
+  m_stats.m_resting_orders.store(m_orders.size(), std::memory_order_relaxed);
+  m_stats.m_ask_levels.store(m_asks.size(), std::memory_order_relaxed);
+  m_stats.m_bid_levels.store(m_bids.size(), std::memory_order_relaxed);
+  // writers already hold the book mutex, a plain store is enough
+  m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
 }
 
 void Orderbook::CancelOrderInternal(OrderId order_id) {
@@ -79,128 +259,325 @@ void Orderbook::CancelOrderInternal(OrderId order_id) {
   if (iter == m_orders.end())
     return;
 
-  const auto &[order_ptr, order_iter] = iter->second;
+  const auto &order_ptr = iter->second.m_order;
+  const auto &order_iter = iter->second.m_pos;
+  if (order_ptr->GetOrderType() == OrderType::Stop || order_ptr->GetOrderType() == OrderType::StopLimit) {
+    auto RemoveStop = [&order_ptr, &order_iter](auto &stops) {
+      auto level = stops.find(order_ptr->GetStopPrice());
+      level->second.erase(order_iter);
+      if (level->second.empty())
+        stops.erase(level);
+    };
+    if (order_ptr->GetSide() == Side::Buy)
+      RemoveStop(m_buy_stops);
+    else
+      RemoveStop(m_sell_stops);
+    EraseOrderEntry(iter);
+    return;
+  }
+
   auto price = order_ptr->GetPrice();
   if (order_ptr->GetSide() == Side::Buy) {
-    auto &orders = m_bids[price];
-    orders.erase(order_iter);
+    auto level = m_bids.find(price);
+    level->second.m_quantity -= order_ptr->GetRemainingQuantity();
+    level->second.m_hidden_quantity -= order_ptr->GetRemainingQuantity() - order_ptr->GetDisplayedQuantity();
+    level->second.m_orders.erase(order_iter);
 
-    if (orders.empty())
-      m_bids.erase(price);
+    if (level->second.m_orders.empty())
+      m_bids.erase(level);
   } else {
-    auto &orders = m_asks[price];
-    orders.erase(order_iter);
+    auto level = m_asks.find(price);
+    level->second.m_quantity -= order_ptr->GetRemainingQuantity();
+    level->second.m_hidden_quantity -= order_ptr->GetRemainingQuantity() - order_ptr->GetDisplayedQuantity();
+    level->second.m_orders.erase(order_iter);
 
-    if (orders.empty())
-      m_asks.erase(price);
+    if (level->second.m_orders.empty())
+      m_asks.erase(level);
   }
-  m_orders.erase(iter);
+  EraseOrderEntry(iter);
 }
 
 LevelInfoss Orderbook::GetLevelInfos() const {
+  std::scoped_lock l(m_order_mutex);
   LevelInfos ask_infos, bid_infos;
 
-  auto CreateLevelInfo = [](Price price, OrderPtrs orders) -> LevelInfo {
-    return {price, std::accumulate(orders.begin(), orders.end(), (Quantity)0, [](Quantity sum, OrderPtr order_ptr) {
-              return sum + order_ptr->GetRemainingQuantity();
-            })};
-  };
+  ask_infos.reserve(m_asks.size());
+  bid_infos.reserve(m_bids.size());
 
-  for (const auto &[ask_price, ask_orders] : m_asks)
-    ask_infos.emplace_back(CreateLevelInfo(ask_price, ask_orders));
+  for (const auto &[ask_price, ask_level] : m_asks)
+    ask_infos.push_back({ask_price, ask_level.m_quantity - ask_level.m_hidden_quantity});
   std::reverse(ask_infos.begin(), ask_infos.end());
 
-  for (const auto &[bid_price, bid_orders] : m_bids)
-    bid_infos.emplace_back(CreateLevelInfo(bid_price, bid_orders));
+  for (const auto &[bid_price, bid_level] : m_bids)
+    bid_infos.push_back({bid_price, bid_level.m_quantity - bid_level.m_hidden_quantity});
 
   return {ask_infos, bid_infos};
 }
 
+MemoryFootprint Orderbook::GetMemoryFootprint() const {
+  std::scoped_lock l(m_order_mutex);
+  MemoryFootprint footprint{};
+  footprint.m_order_count = m_orders.size();
+  footprint.m_reserved_bytes = m_reserved_bytes;
+  footprint.m_pool_bytes = m_pool_upstream.GetBytes();
+  footprint.m_level_bytes = (m_asks.size() + m_bids.size()) * kLevelNodeBytes +
+                            (m_buy_stops.size() + m_sell_stops.size()) * (kTreeNodeBytes + sizeof(std::pair<const Price, OrderPtrs>));
+  footprint.m_queue_bytes = m_orders.size() * kListNodeBytes;
+  for (const auto &[_, entry] : m_orders)
+    footprint.m_order_bytes += kControlBlockBytes + entry.m_order->GetObjectSize();
+  footprint.m_index_bytes =
+      m_orders.size() * (kHashNodeBytes + sizeof(std::pair<const OrderId, OrderEntry>)) + m_orders.bucket_count() * sizeof(void *);
+  footprint.m_index_bytes += m_participant_orders.size() * (kHashNodeBytes + sizeof(std::pair<const ParticipantId, ParticipantOrders>)) +
+                             m_participant_orders.bucket_count() * sizeof(void *);
+  for (const auto &[_, order_ids] : m_participant_orders)
+    footprint.m_index_bytes += order_ids.size() * (2 * sizeof(void *) + sizeof(OrderId));
+  return footprint;
+}
+
+void Orderbook::BeginAuction() {
+  std::scoped_lock l(m_order_mutex);
+  m_phase.store(TradingPhase::Auction, std::memory_order_release);
+}
+
+std::optional<Price> Orderbook::UncrossPrice() const {
+  if (m_asks.empty() || m_bids.empty() || m_asks.begin()->first > m_bids.begin()->first)
+    return std::nullopt;
+
+  // only prices inside [best ask, best bid] can execute, walk them in ascending order. the ask side accumulates
+  // levels at or below the candidate price, the bid side drops levels below it, so every candidate is O(1)
+  const Price lowest = m_asks.begin()->first, highest = m_bids.begin()->first;
+  uint64_t ask_cumulative = 0, bid_cumulative = 0;
+  for (auto bid = m_bids.begin(); bid != m_bids.end() && bid->first >= lowest; ++bid)
+    bid_cumulative += bid->second.m_quantity;
+
+  auto ask = m_asks.begin();
+  auto bid = std::find_if(m_bids.rbegin(), m_bids.rend(), [lowest](const auto &level) { return level.first >= lowest; });
+  Price uncross_price = lowest;
+  uint64_t best_volume = 0, best_imbalance = 0;
+  while ((ask != m_asks.end() && ask->first <= highest) || (bid != m_bids.rend() && bid->first <= highest)) {
+    const Price price = std::min(ask != m_asks.end() && ask->first <= highest ? ask->first : highest,
+                                 bid != m_bids.rend() ? bid->first : highest);
+    for (; ask != m_asks.end() && ask->first == price; ++ask)
+      ask_cumulative += ask->second.m_quantity;
+
+    const uint64_t volume = std::min(ask_cumulative, bid_cumulative);
+    const uint64_t imbalance = ask_cumulative > bid_cumulative ? ask_cumulative - bid_cumulative : bid_cumulative - ask_cumulative;
+    // maximum volume first, then minimum surplus, then the higher price while buyers are left over
+    if (volume > best_volume || (volume == best_volume && imbalance < best_imbalance) ||
+        (volume == best_volume && imbalance == best_imbalance && bid_cumulative > ask_cumulative)) {
+      uncross_price = price;
+      best_volume = volume;
+      best_imbalance = imbalance;
+    }
+
+    for (; bid != m_bids.rend() && bid->first == price; ++bid)
+      bid_cumulative -= bid->second.m_quantity;
+  }
+  return uncross_price;
+}
+
+Trades Orderbook::Uncross() {
+  std::scoped_lock l(m_order_mutex);
+  m_phase.store(TradingPhase::Continuous, std::memory_order_release);
+  Trades trades;
+  // self trade prevention can cancel or shrink volume the price was picked for and stop the pass with the book still
+  // crossed, so price what is left and match again. every pass removes quantity, the loop ends once nothing crosses
+  while (auto uncross_price = UncrossPrice()) {
+    Trades pass = MatchOrders(uncross_price);
+    if (!pass.empty())
+      m_last_trade_price = *uncross_price;
+    trades.insert(trades.end(), pass.begin(), pass.end());
+  }
+  // stops parked through the auction go out even when nothing crossed
+  ReleaseStopOrders(trades);
+  Increment(m_stats.m_trades, trades.size());
+  PublishChange();
+  return trades;
+}
+
+bool Orderbook::StopTriggered(Side side, Price stop_price) const {
+  return m_last_trade_price && (side == Side::Buy ? *m_last_trade_price >= stop_price : *m_last_trade_price <= stop_price);
+}
+
+void Orderbook::ReleaseStopOrders(Trades &trades) {
+  if (m_phase.load(std::memory_order_relaxed) == TradingPhase::Auction)
+    return;
+
+  // only the front of each index can be triggered, so every release is a map head lookup rather than a scan. buy stops
+  // go first, lowest stop price first and FIFO within a price, and each release may move the last price again
+  auto PopStop = [this](auto &stops) {
+    auto level = stops.begin();
+    OrderPtr order = level->second.front();
+    level->second.pop_front();
+    if (level->second.empty())
+      stops.erase(level);
+    EraseOrderEntry(m_orders.find(order->GetOrderId()));
+    return order;
+  };
+
+  while (true) {
+    OrderPtr order;
+    if (!m_buy_stops.empty() && StopTriggered(Side::Buy, m_buy_stops.begin()->first))
+      order = PopStop(m_buy_stops);
+    else if (!m_sell_stops.empty() && StopTriggered(Side::Sell, m_sell_stops.begin()->first))
+      order = PopStop(m_sell_stops);
+    else
+      break;
+
+    order->Trigger();
+    Trades released = AddOrderInternal(order);
+    trades.insert(trades.end(), released.begin(), released.end());
+  }
+}
+
 bool Orderbook::MatchPrice(Side side, Price price) const {
   return side == Side::Buy ? !m_asks.empty() && m_asks.begin()->first <= price : !m_bids.empty() && m_bids.begin()->first >= price;
 }
 
-bool Orderbook::MatchQuantity(Side side, Price price, Quantity quantity) const {
-  Quantity orderbook_quantity = 0;
-  if (side == Side::Buy && m_asks.begin()->first <= price) {
-    auto cur_price = m_asks.begin();
-    while (cur_price != m_asks.end() && cur_price->first <= price && orderbook_quantity < quantity) {
-      orderbook_quantity += std::accumulate(cur_price->second.begin(), cur_price->second.end(), 0, [](Quantity accum, OrderPtr order) {
-        return accum + order->GetRemainingQuantity();
-      });
-      ++cur_price;
-    }
-  } else if (side == Side::Sell && m_bids.begin()->first >= price) {
-    auto cur_price = m_bids.begin();
-    while (cur_price != m_bids.end() && orderbook_quantity < quantity) {
-      orderbook_quantity += std::accumulate(cur_price->second.begin(), cur_price->second.end(), 0, [](Quantity accum, OrderPtr order) {
-        return accum + order->GetRemainingQuantity();
-      });
-      ++cur_price;
+bool Orderbook::MatchQuantity(const OrderInterface &order) const {
+  const Price price = order.GetPrice();
+  const Quantity quantity = order.GetRemainingQuantity();
+  const SelfTradePrevention prevention = order.GetSelfTradePrevention();
+  const ParticipantId participant_id = prevention != SelfTradePrevention::None ? order.GetParticipantId() : 0;
+  uint64_t orderbook_quantity = 0;
+
+  auto Count = [&](const auto &levels, auto crosses) {
+    for (auto level = levels.begin(); level != levels.end() && crosses(level->first) && orderbook_quantity < quantity; ++level) {
+      if (!participant_id) {
+        orderbook_quantity += level->second.m_quantity;
+        continue;
+      }
+      // the incoming order is the newest, so its mode decides: decrement consumes its own orders, cancel oldest
+      // skips them and cancel newest or both end the order at the first one. ahead of that one an iceberg only fills
+      // its clip, the refresh queues the rest behind it
+      uint64_t displayed = 0, remaining = 0;
+      for (const auto &resting : level->second.m_orders) {
+        if (resting->GetParticipantId() == participant_id && prevention != SelfTradePrevention::Decrement) {
+          if (prevention == SelfTradePrevention::CancelOldest)
+            continue;
+          orderbook_quantity += displayed;
+          return;
+        }
+        displayed += resting->GetDisplayedQuantity();
+        remaining += resting->GetRemainingQuantity();
+        if (orderbook_quantity + displayed >= quantity) {
+          orderbook_quantity += displayed;
+          return;
+        }
+      }
+      orderbook_quantity += remaining;
     }
-  }
+  };
+  if (order.GetSide() == Side::Buy)
+    Count(m_asks, [price](Price level_price) { return level_price <= price; });
+  else
+    Count(m_bids, [price](Price level_price) { return level_price >= price; });
   return orderbook_quantity >= quantity;
 }
 
-Trades Orderbook::MatchOrders() {
+Trades Orderbook::MatchOrders(std::optional<Price> uncross_price) {
+  // most calls fill nothing or one or two orders, reserving for the whole book cost an allocation per order
   Trades trades;
-  trades.reserve(m_orders.size());
 
   while (true) {
     if (m_asks.empty() || m_bids.empty())
       break;
 
-    auto &[ask_price, ask_orders] = *m_asks.begin();
-    auto &[bid_price, bid_orders] = *m_bids.begin();
+    auto &[ask_price, ask_level] = *m_asks.begin();
+    auto &[bid_price, bid_level] = *m_bids.begin();
     if (ask_price > bid_price) {
       break;
     }
+    if (uncross_price && (ask_price > *uncross_price || bid_price < *uncross_price))
+      break;
 
+    auto &ask_orders = ask_level.m_orders;
+    auto &bid_orders = bid_level.m_orders;
     while (ask_orders.size() && bid_orders.size()) {
-      auto &ask = ask_orders.front();
-      auto &bid = bid_orders.front();
+      // raw pointers keep the loop off the control block lines, the id index holds a reference until EraseOrderEntry
+      OrderInterface *ask = ask_orders.front().get();
+      OrderInterface *bid = bid_orders.front().get();
+
+      // both orders are already at hand, so self trade prevention costs one compare per fill. only a self cross looks
+      // up the arrivals, ids come from the caller and need not rise
+      SelfTradePrevention prevention = SelfTradePrevention::None;
+      bool ask_newest = false;
+      if (ask->GetParticipantId() && ask->GetParticipantId() == bid->GetParticipantId()) {
+        ask_newest = m_orders.find(ask->GetOrderId())->second.m_arrival > m_orders.find(bid->GetOrderId())->second.m_arrival;
+        prevention = (ask_newest ? ask : bid)->GetSelfTradePrevention();
+      }
 
-      Quantity quantity = std::min(ask->GetRemainingQuantity(), bid->GetRemainingQuantity());
+      if (prevention == SelfTradePrevention::CancelNewest || prevention == SelfTradePrevention::CancelOldest ||
+          prevention == SelfTradePrevention::CancelBoth) {
+        if (prevention == SelfTradePrevention::CancelBoth || (prevention == SelfTradePrevention::CancelNewest) == ask_newest)
+          RemoveFront(ask_level);
+        if (prevention == SelfTradePrevention::CancelBoth || (prevention == SelfTradePrevention::CancelNewest) != ask_newest)
+          RemoveFront(bid_level);
+        continue;
+      }
+
+      Quantity quantity = std::min(ask->GetDisplayedQuantity(), bid->GetDisplayedQuantity());
       ask->Fill(quantity);
       bid->Fill(quantity);
+      ask_level.m_quantity -= quantity;
+      bid_level.m_quantity -= quantity;
+      // decrement shrinks both orders by the overlap without printing a trade
+      if (prevention != SelfTradePrevention::Decrement)
+        trades.emplace_back(TradeInfo{ask->GetOrderId(), uncross_price.value_or(ask->GetPrice()), quantity},
+                            TradeInfo{bid->GetOrderId(), uncross_price.value_or(bid->GetPrice()), quantity});
 
       if (ask->IsFilled()) {
         ask_orders.pop_front();
-        m_orders.erase(ask->GetOrderId());
+        EraseOrderEntry(m_orders.find(ask->GetOrderId()));
+      } else if (!ask->GetDisplayedQuantity()) {
+        ReplenishFront(ask_level);
       }
       if (bid->IsFilled()) {
         bid_orders.pop_front();
-        m_orders.erase(bid->GetOrderId());
+        EraseOrderEntry(m_orders.find(bid->GetOrderId()));
+      } else if (!bid->GetDisplayedQuantity()) {
+        ReplenishFront(bid_level);
       }
-
-      if (ask_orders.empty())
-        m_asks.erase(ask_price);
-      if (bid_orders.empty())
-        m_bids.erase(bid_price);
-
-      trades.emplace_back(TradeInfo{ask->GetOrderId(), ask->GetPrice(), quantity}, TradeInfo{bid->GetOrderId(), bid->GetPrice(), quantity});
     }
+
+    if (ask_orders.empty())
+      m_asks.erase(m_asks.begin());
+    if (bid_orders.empty())
+      m_bids.erase(m_bids.begin());
   }
 
   if (!m_asks.empty()) {
-    auto &[_, ask_orders] = *m_asks.begin();
-    auto &order = ask_orders.front();
+    auto &order = m_asks.begin()->second.m_orders.front();
     if (order->GetOrderType() == OrderType::FillAndKill) {
-      CancelOrder(order->GetOrderId());
+      CancelOrderInternal(order->GetOrderId());
     }
   }
 
   if (!m_bids.empty()) {
-    auto &[_, bid_orders] = *m_bids.begin();
-    auto &order = bid_orders.front();
+    auto &order = m_bids.begin()->second.m_orders.front();
     if (order->GetOrderType() == OrderType::FillAndKill) {
-      CancelOrder(order->GetOrderId());
+      CancelOrderInternal(order->GetOrderId());
     }
   }
 
   return trades;
 }
 
+void Orderbook::RemoveFront(Level &level) {
+  // leaves the level in its map even when it empties, callers iterating the level erase it themselves
+  const auto &order = level.m_orders.front();
+  level.m_quantity -= order->GetRemainingQuantity();
+  level.m_hidden_quantity -= order->GetRemainingQuantity() - order->GetDisplayedQuantity();
+  EraseOrderEntry(m_orders.find(order->GetOrderId()));
+  level.m_orders.pop_front();
+}
+
+void Orderbook::ReplenishFront(Level &level) {
+  // splice relinks the existing node at the back of the queue, the order keeps its iterator and nothing is allocated
+  level.m_hidden_quantity -= level.m_orders.front()->Replenish();
+  level.m_orders.splice(level.m_orders.end(), level.m_orders, level.m_orders.begin());
+}
+
 void Orderbook::PruneDayOrders() {
   while (true) {
     const auto tt = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
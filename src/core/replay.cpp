@@ -0,0 +1,197 @@
+#include "core/replay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+namespace OrderbookCore {
+namespace {
+// each worker owns a deque, it pops its own back and steals from the front of the others once it runs dry.
+// every task is queued before the workers start, so a full sweep that finds nothing means the run is done
+class WorkStealingQueues {
+public:
+  explicit WorkStealingQueues(std::size_t worker_count) : m_queues(worker_count) {}
+
+  void Push(std::size_t worker, std::size_t task) { m_queues[worker].m_tasks.push_back(task); }
+
+  std::optional<std::size_t> Pop(std::size_t worker) {
+    for (std::size_t i = 0; i < m_queues.size(); ++i) {
+      auto &queue = m_queues[(worker + i) % m_queues.size()];
+      std::scoped_lock l(queue.m_mutex);
+      if (queue.m_tasks.empty())
+        continue;
+
+      std::size_t task;
+      if (i == 0) {
+        task = queue.m_tasks.back();
+        queue.m_tasks.pop_back();
+      } else {
+        task = queue.m_tasks.front();
+        queue.m_tasks.pop_front();
+      }
+      return task;
+    }
+    return std::nullopt;
+  }
+
+private:
+  // one line per queue so a thief locking its victim does not bounce the owner's line
+  struct alignas(kCacheLineSize) Queue {
+    std::mutex m_mutex;
+    std::deque<std::size_t> m_tasks;
+  };
+  std::vector<Queue> m_queues;
+};
+
+SequencedTrades ReplaySymbol(std::size_t symbol, const std::vector<ReplayEvent> &events) {
+  OrderbookConfig config;
+  config.m_prune_day_orders = false;
+  Orderbook orderbook{config};
+
+  SequencedTrades trades;
+  for (const auto &event : events) {
+    Trades event_trades;
+    switch (event.m_action) {
+    case ReplayAction::Add:
+      event_trades = orderbook.AddOrder(OrderFactory::CreateOrder(event.m_order_id, SideItems[static_cast<int>(event.m_side)], event.m_type,
+                                                                  event.m_quantity, event.m_price, event.m_display_quantity, event.m_stop_price));
+      break;
+    case ReplayAction::Cancel:
+      orderbook.CancelOrder(event.m_order_id);
+      break;
+    case ReplayAction::Modify:
+      if (event.m_side == Side::Buy)
+        event_trades = orderbook.ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>(event.m_order_id, event.m_price, event.m_quantity));
+      else
+        event_trades = orderbook.ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Sell>>(event.m_order_id, event.m_price, event.m_quantity));
+      break;
+    }
+    for (const auto &trade : event_trades)
+      trades.push_back({0, event.m_sequence, symbol, trade});
+  }
+  return trades;
+}
+} // namespace
+
+ReplayStream ReplayStream::Read(std::istream &in) {
+  ReplayStream stream;
+  std::string line, symbol, action, side, type;
+  std::size_t line_number = 0;
+  uint64_t last_sequence = 0;
+
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    auto Fail = [line_number] { throw std::invalid_argument("Malformed replay event on line " + std::to_string(line_number)); };
+    auto ParseSide = [&] {
+      if (side == SideItems[static_cast<int>(Side::Buy)])
+        return Side::Buy;
+      if (side == SideItems[static_cast<int>(Side::Sell)])
+        return Side::Sell;
+      Fail();
+      return Side::Unknown;
+    };
+
+    std::istringstream fields{line};
+    ReplayEvent event{};
+    // sequences must rise through the file, the merge relies on them to reproduce the recorded order
+    if (!(fields >> event.m_sequence >> symbol >> action) || (stream.m_size && event.m_sequence <= last_sequence))
+      Fail();
+
+    if (action == "A") {
+      if (!(fields >> side >> type >> event.m_order_id >> event.m_price >> event.m_quantity))
+        Fail();
+      event.m_action = ReplayAction::Add;
+      event.m_side = ParseSide();
+      auto item = std::find_if(std::begin(OrderTypeItems), std::end(OrderTypeItems), [&](const char *item) { return type == item; });
+      if (item == std::end(OrderTypeItems))
+        Fail();
+      event.m_type = *item;
+      // display quantity and stop price are optional and read as zero when absent
+      fields >> event.m_display_quantity >> event.m_stop_price;
+    } else if (action == "C") {
+      if (!(fields >> event.m_order_id))
+        Fail();
+      event.m_action = ReplayAction::Cancel;
+    } else if (action == "M") {
+      if (!(fields >> event.m_order_id >> side >> event.m_price >> event.m_quantity))
+        Fail();
+      event.m_action = ReplayAction::Modify;
+      event.m_side = ParseSide();
+    } else {
+      Fail();
+    }
+
+    last_sequence = event.m_sequence;
+    stream.Append(symbol, event);
+  }
+  return stream;
+}
+
+void ReplayStream::Append(const std::string &symbol, const ReplayEvent &event) {
+  auto [iter, inserted] = m_symbol_index.try_emplace(symbol, m_symbols.size());
+  if (inserted) {
+    m_symbols.push_back(symbol);
+    m_events.emplace_back();
+  }
+  m_events[iter->second].push_back(event);
+  ++m_size;
+}
+
+ReplayEngine::ReplayEngine(std::size_t thread_count) : m_thread_count(std::max<std::size_t>(1, thread_count)) {}
+
+SequencedTrades ReplayEngine::Run(const ReplayStream &stream) const {
+  const std::size_t symbol_count = stream.GetSymbols().size();
+  const std::size_t worker_count = std::max<std::size_t>(1, std::min(m_thread_count, symbol_count));
+
+  // dealt smallest first, so every owner starts on its busiest symbol and thieves take the short tail
+  std::vector<std::size_t> symbols(symbol_count);
+  std::iota(symbols.begin(), symbols.end(), 0);
+  std::stable_sort(symbols.begin(), symbols.end(),
+                   [&](std::size_t lhs, std::size_t rhs) { return stream.GetEvents(lhs).size() < stream.GetEvents(rhs).size(); });
+  WorkStealingQueues queues{worker_count};
+  for (std::size_t i = 0; i < symbol_count; ++i)
+    queues.Push(i % worker_count, symbols[i]);
+
+  // results land in the symbol's slot, never in completion order
+  std::vector<SequencedTrades> symbol_trades(symbol_count);
+  auto Work = [&](std::size_t worker) {
+    while (auto symbol = queues.Pop(worker))
+      symbol_trades[*symbol] = ReplaySymbol(*symbol, stream.GetEvents(*symbol));
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t worker = 1; worker < worker_count; ++worker)
+    workers.emplace_back(Work, worker);
+  Work(0);
+  for (auto &worker : workers)
+    worker.join();
+
+  SequencedTrades trades;
+  trades.reserve(std::accumulate(symbol_trades.begin(), symbol_trades.end(), std::size_t{0},
+                                 [](std::size_t total, const SequencedTrades &part) { return total + part.size(); }));
+  for (auto &part : symbol_trades)
+    trades.insert(trades.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+  // trades of one event come from one book and are already in match order, the stable sort keeps it
+  std::stable_sort(trades.begin(), trades.end(),
+                   [](const SequencedTrade &lhs, const SequencedTrade &rhs) { return lhs.m_input_sequence < rhs.m_input_sequence; });
+  for (std::size_t i = 0; i < trades.size(); ++i)
+    trades[i].m_sequence = i + 1;
+  return trades;
+}
+
+void ReplayEngine::Write(std::ostream &out, const ReplayStream &stream, const SequencedTrades &trades) {
+  for (const auto &trade : trades) {
+    const auto &bid = trade.m_trade.GetBidTrade();
+    const auto &ask = trade.m_trade.GetAskTrade();
+    out << trade.m_sequence << ' ' << trade.m_input_sequence << ' ' << stream.GetSymbols()[trade.m_symbol] << ' ' << bid.m_order_id << ' '
+        << bid.m_price << ' ' << bid.m_quantity << ' ' << ask.m_order_id << ' ' << ask.m_price << ' ' << ask.m_quantity << '\n';
+  }
+}
+}
@@ -0,0 +1,35 @@
+#include "core/stats.h"
+
+namespace OrderbookCore {
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+  std::size_t bucket = nanoseconds ? 64 - __builtin_clzll(nanoseconds) : 0;
+  if (bucket >= kBucketCount)
+    bucket = kBucketCount - 1;
+  Increment(m_buckets[bucket]);
+}
+
+uint64_t LatencyHistogram::Count() const {
+  uint64_t count = 0;
+  for (const auto &bucket : m_buckets)
+    count += bucket.load(std::memory_order_relaxed);
+  return count;
+}
+
+uint64_t LatencyHistogram::Percentile(double fraction) const {
+  std::array<uint64_t, kBucketCount> buckets;
+  uint64_t count = 0;
+  for (std::size_t i = 0; i < kBucketCount; ++i)
+    count += buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+  if (!count)
+    return 0;
+
+  const uint64_t rank = static_cast<uint64_t>(fraction * (count - 1));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBucketCount; ++i) {
+    seen += buckets[i];
+    if (seen > rank)
+      return uint64_t{1} << i;
+  }
+  return uint64_t{1} << (kBucketCount - 1);
+}
+}
@@ -0,0 +1,243 @@
+#include "core/tape.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace OrderbookCore {
+namespace {
+constexpr char kMagic[8] = {'O', 'B', 'T', 'A', 'P', 'E', '0', '1'};
+static_assert(sizeof(TapeBlockHeader) == 72, "tape block header is written as is and must keep its layout");
+
+enum Column {
+  kTimestamp,
+  kPrice,
+  kQuantity,
+  kBuyer,
+  kSeller,
+};
+
+void PutVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t GetVarint(const uint8_t *&in) {
+  uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    const uint8_t byte = *in++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+// small deltas of either sign stay small after encoding
+uint64_t ZigZag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+int64_t UnZigZag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+void Merge(TapeBar &bar, uint64_t trade_count, uint64_t volume, int64_t notional, Price open, Price high, Price low, Price close) {
+  if (!bar.m_trade_count) {
+    bar.m_open = open;
+    bar.m_high = high;
+    bar.m_low = low;
+  } else {
+    bar.m_high = std::max(bar.m_high, high);
+    bar.m_low = std::min(bar.m_low, low);
+  }
+  bar.m_close = close;
+  bar.m_trade_count += trade_count;
+  bar.m_volume += volume;
+  bar.m_notional += notional;
+}
+
+void Merge(TapeBar &bar, const TapeBlockHeader &header) {
+  Merge(bar, header.m_trade_count, header.m_volume, header.m_notional, header.m_open, header.m_max_price, header.m_min_price, header.m_close);
+}
+
+void Merge(TapeBar &bar, Price price, Quantity quantity) { Merge(bar, 1, quantity, static_cast<int64_t>(price) * quantity, price, price, price, price); }
+
+// walks the block headers after the magic and returns where the last complete block ends. a writer that died mid
+// block leaves a torn tail, everything before it is intact
+template <typename Visit> std::streamoff ReadHeaders(std::istream &in, std::streamoff size, Visit &&visit) {
+  std::streamoff end = sizeof(kMagic);
+  in.seekg(end);
+  TapeBlockHeader header;
+  while (in.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    std::streamoff payload = 0;
+    for (auto bytes : header.m_column_bytes)
+      payload += bytes;
+    const std::streamoff offset = end + sizeof(header);
+    if (offset + payload > size)
+      break;
+    visit(header, offset);
+    end = offset + payload;
+    in.seekg(end);
+  }
+  in.clear();
+  return end;
+}
+
+// the tape is time ordered, so a bar only ever opens after the last one
+TapeBar &BarAt(TapeBars &bars, uint64_t start) {
+  if (bars.empty() || bars.back().m_start != start)
+    bars.push_back({start});
+  return bars.back();
+}
+} // namespace
+
+TradeTapeWriter::TradeTapeWriter(const std::string &path) {
+  std::error_code error;
+  std::streamoff size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+  if (size) {
+    // cut a torn tail back to the last complete block, blocks appended after it would be unreachable. timestamps
+    // carry on from where the tape stopped
+    std::ifstream in{path, std::ios::binary};
+    char magic[sizeof(kMagic)];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(kMagic)))
+      throw std::runtime_error("Not a trade tape " + path);
+    const std::streamoff end =
+        ReadHeaders(in, size, [this](const TapeBlockHeader &header, std::streamoff) { m_last_timestamp = header.m_max_timestamp; });
+    in.close();
+    if (end < size)
+      std::filesystem::resize_file(path, end);
+  }
+  m_out.open(path, std::ios::binary | std::ios::app);
+  if (!m_out)
+    throw std::runtime_error("Cannot open trade tape " + path);
+  if (!size)
+    m_out.write(kMagic, sizeof(kMagic));
+}
+
+TradeTapeWriter::~TradeTapeWriter() { Flush(); }
+
+void TradeTapeWriter::Append(uint64_t timestamp, Price price, Quantity quantity, OrderId buyer, OrderId seller) {
+  if (timestamp < m_last_timestamp)
+    throw std::invalid_argument("Trade tape timestamps cannot go backwards");
+
+  // deltas restart in every block, so each block decodes on its own
+  if (!m_header.m_trade_count) {
+    m_header.m_min_timestamp = timestamp;
+    m_header.m_min_price = m_header.m_max_price = m_header.m_open = price;
+    m_last_timestamp = timestamp;
+    m_last_price = price;
+    m_last_buyer = m_last_seller = 0;
+  }
+  PutVarint(m_columns[kTimestamp], timestamp - m_last_timestamp);
+  PutVarint(m_columns[kPrice], ZigZag(static_cast<int64_t>(price) - m_last_price));
+  PutVarint(m_columns[kQuantity], quantity);
+  PutVarint(m_columns[kBuyer], ZigZag(static_cast<int64_t>(buyer - m_last_buyer)));
+  PutVarint(m_columns[kSeller], ZigZag(static_cast<int64_t>(seller - m_last_seller)));
+  m_last_timestamp = timestamp;
+  m_last_price = price;
+  m_last_buyer = buyer;
+  m_last_seller = seller;
+
+  m_header.m_max_timestamp = timestamp;
+  m_header.m_min_price = std::min(m_header.m_min_price, price);
+  m_header.m_max_price = std::max(m_header.m_max_price, price);
+  m_header.m_close = price;
+  m_header.m_volume += quantity;
+  m_header.m_notional += static_cast<int64_t>(price) * quantity;
+  if (++m_header.m_trade_count == kBlockTrades)
+    Flush();
+}
+
+void TradeTapeWriter::Append(uint64_t timestamp, const Trades &trades, Side aggressor) {
+  for (const auto &trade : trades) {
+    const auto &bid = trade.GetBidTrade();
+    const auto &ask = trade.GetAskTrade();
+    Append(timestamp, aggressor == Side::Buy ? ask.m_price : bid.m_price, bid.m_quantity, bid.m_order_id, ask.m_order_id);
+  }
+}
+
+void TradeTapeWriter::Flush() {
+  if (!m_header.m_trade_count)
+    return;
+
+  for (int column = kTimestamp; column <= kSeller; ++column)
+    m_header.m_column_bytes[column] = m_columns[column].size();
+  m_out.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+  for (auto &column : m_columns) {
+    m_out.write(reinterpret_cast<const char *>(column.data()), column.size());
+    column.clear();
+  }
+  m_out.flush();
+  m_header = {};
+}
+
+TradeTapeReader::TradeTapeReader(const std::string &path) : m_in(path, std::ios::binary) {
+  char magic[sizeof(kMagic)];
+  if (!m_in.read(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(kMagic)))
+    throw std::runtime_error("Not a trade tape " + path);
+
+  m_in.seekg(0, std::ios::end);
+  ReadHeaders(m_in, m_in.tellg(), [this](const TapeBlockHeader &header, std::streamoff offset) {
+    m_trade_count += header.m_trade_count;
+    m_blocks.push_back({header, offset});
+  });
+}
+
+template <typename Visit> void TradeTapeReader::Scan(const Block &block, uint64_t from, uint64_t to, Visit &&visit) const {
+  const auto &header = block.m_header;
+  // aggregates need the first three columns only, the order ids stay on disk
+  const std::size_t bytes = header.m_column_bytes[kTimestamp] + header.m_column_bytes[kPrice] + header.m_column_bytes[kQuantity];
+  m_buffer.resize(bytes);
+  m_in.seekg(block.m_offset);
+  m_in.read(reinterpret_cast<char *>(m_buffer.data()), bytes);
+  ++m_decoded_blocks;
+
+  const uint8_t *timestamps = m_buffer.data();
+  const uint8_t *prices = timestamps + header.m_column_bytes[kTimestamp];
+  const uint8_t *quantities = prices + header.m_column_bytes[kPrice];
+  uint64_t timestamp = header.m_min_timestamp;
+  int64_t price = header.m_open;
+  for (uint32_t i = 0; i < header.m_trade_count; ++i) {
+    timestamp += GetVarint(timestamps);
+    price += UnZigZag(GetVarint(prices));
+    const auto quantity = static_cast<Quantity>(GetVarint(quantities));
+    if (timestamp >= to)
+      break;
+    if (timestamp >= from)
+      visit(timestamp, static_cast<Price>(price), quantity);
+  }
+}
+
+TapeBar TradeTapeReader::Summarize(uint64_t from, uint64_t to) const {
+  m_decoded_blocks = 0;
+  TapeBar bar{from};
+  for (const auto &block : m_blocks) {
+    const auto &header = block.m_header;
+    if (header.m_max_timestamp < from || header.m_min_timestamp >= to)
+      continue;
+    if (header.m_min_timestamp >= from && header.m_max_timestamp < to)
+      Merge(bar, header);
+    else
+      Scan(block, from, to, [&bar](uint64_t, Price price, Quantity quantity) { Merge(bar, price, quantity); });
+  }
+  return bar;
+}
+
+TapeBars TradeTapeReader::Bars(uint64_t from, uint64_t to, uint64_t width) const {
+  m_decoded_blocks = 0;
+  TapeBars bars;
+  if (!width)
+    return bars;
+
+  auto BarStart = [from, width](uint64_t timestamp) { return from + (timestamp - from) / width * width; };
+  for (const auto &block : m_blocks) {
+    const auto &header = block.m_header;
+    if (header.m_max_timestamp < from || header.m_min_timestamp >= to)
+      continue;
+    if (header.m_min_timestamp >= from && header.m_max_timestamp < to && BarStart(header.m_min_timestamp) == BarStart(header.m_max_timestamp))
+      Merge(BarAt(bars, BarStart(header.m_min_timestamp)), header);
+    else
+      Scan(block, from, to, [&](uint64_t timestamp, Price price, Quantity quantity) { Merge(BarAt(bars, BarStart(timestamp)), price, quantity); });
+  }
+  return bars;
+}
+}
@@ -1,49 +1,479 @@
+#include <algorithm>
 #include <cassert>
+#include <filesystem>
 #include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 
-#include "orderbook.h"
+#include "core/orderbook.h"
+#include "core/replay.h"
+#include "core/tape.h"
+
+using namespace OrderbookCore;
 
 int main(void) {
   Orderbook orderbook;
 
   std::cout << "Test Add and Cancel: " << std::endl;
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 100));
+  uint64_t version = orderbook.GetVersion();
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 100));
   assert(orderbook.Size() == 1);
+  assert(orderbook.GetVersion() > version);
+  version = orderbook.GetVersion();
   orderbook.CancelOrder(1);
   assert(orderbook.Size() == 0);
+  assert(orderbook.GetVersion() > version);
   std::cout << "Test passed" << std::endl;
   std::cout << std::endl;
 
   std::cout << "Test Fill: " << std::endl;
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 100));
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 100));
   assert(orderbook.Size() == 1);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Buy, 100, 100));
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(2, 100, 100));
   assert(orderbook.Size() == 0);
   std::cout << "Test passed" << std::endl;
   std::cout << std::endl;
 
   std::cout << "Test FillAndKill: " << std::endl;
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 100));
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 100));
   assert(orderbook.Size() == 1);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::FillAndKill, 2, Side::Buy, 100, 100));
+  orderbook.AddOrder(std::make_shared<FillAndKillOrder<Side::Buy>>(2, 100, 100));
   assert(orderbook.Size() == 0);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 100));
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 100));
   assert(orderbook.Size() == 1);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::FillAndKill, 3, Side::Buy, 100, 50));
+  orderbook.AddOrder(std::make_shared<FillAndKillOrder<Side::Buy>>(3, 100, 50));
   assert(orderbook.Size() == 1);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::FillAndKill, 4, Side::Buy, 100, 50));
+  orderbook.AddOrder(std::make_shared<FillAndKillOrder<Side::Buy>>(4, 100, 50));
   assert(orderbook.Size() == 0);
   std::cout << "Test passed" << std::endl;
   std::cout << std::endl;
 
   std::cout << "Test FillOrKill: " << std::endl;
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 100));
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 100));
   assert(orderbook.Size() == 1);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::FillOrKill, 2, Side::Buy, 100, 200));
+  orderbook.AddOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(2, 100, 200));
   assert(orderbook.Size() == 1);
-  orderbook.AddOrder(std::make_shared<Order>(OrderType::FillOrKill, 3, Side::Buy, 100, 100));
+  orderbook.AddOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(3, 100, 100));
   assert(orderbook.Size() == 0);
   std::cout << "Test passed" << std::endl;
   std::cout << std::endl;
-  orderbook.Print();
+
+  std::cout << "Test Auction Uncross: " << std::endl;
+  orderbook.BeginAuction();
+  assert(orderbook.GetTradingPhase() == TradingPhase::Auction);
+  assert(orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(1, 102, 10)).empty());
+  assert(orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(2, 101, 10)).empty());
+  assert(orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(3, 100, 10)).empty());
+  assert(orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(4, 99, 10)).empty());
+  assert(orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(5, 100, 10)).empty());
+  assert(orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(6, 101, 15)).empty());
+  assert(orderbook.AddOrder(std::make_shared<FillAndKillOrder<Side::Buy>>(7, 101, 15)).empty());
+  assert(orderbook.Size() == 6);
+  {
+    // 100 and 101 both execute 20, 100 leaves the smaller surplus
+    Trades trades = orderbook.Uncross();
+    Quantity volume = 0;
+    for (const auto &trade : trades) {
+      assert(trade.GetAskTrade().m_price == 100 && trade.GetBidTrade().m_price == 100);
+      volume += trade.GetAskTrade().m_quantity;
+    }
+    assert(volume == 20);
+  }
+  assert(orderbook.GetTradingPhase() == TradingPhase::Continuous);
+  assert(orderbook.Size() == 2);
+  orderbook.CancelOrders({3, 6});
+  assert(orderbook.Size() == 0);
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Iceberg: " << std::endl;
+  orderbook.AddOrder(std::make_shared<IcebergOrder<Side::Sell>>(1, 100, 100, 10));
+  orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(2, 100, 20));
+  assert(orderbook.GetLevelInfos().first.front().m_quantity == 30);
+  {
+    // the clip fills first, then the iceberg refreshes behind order 2
+    Trades trades = orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(3, 100, 15));
+    assert(trades.size() == 2);
+    assert(trades[0].GetAskTrade().m_order_id == 1 && trades[0].GetAskTrade().m_quantity == 10);
+    assert(trades[1].GetAskTrade().m_order_id == 2 && trades[1].GetAskTrade().m_quantity == 5);
+  }
+  assert(orderbook.GetLevelInfos().first.front().m_quantity == 25);
+  {
+    Trades trades = orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(4, 100, 110));
+    assert(trades[0].GetAskTrade().m_order_id == 2);
+    Quantity volume = 0;
+    for (const auto &trade : trades)
+      volume += trade.GetBidTrade().m_quantity;
+    assert(volume == 105);
+  }
+  assert(orderbook.Size() == 1);
+  assert(orderbook.GetLevelInfos().second.front().m_quantity == 5);
+  orderbook.CancelOrder(4);
+  assert(orderbook.Size() == 0);
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Stop: " << std::endl;
+  {
+    // last trade price starts unset on a new book
+    Orderbook stop_orderbook;
+    stop_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 101, 10));
+    stop_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(2, 102, 10));
+    assert(stop_orderbook.AddOrder(std::make_shared<StopOrder<Side::Buy>>(3, 101, 10)).empty());
+    assert(stop_orderbook.AddOrder(std::make_shared<StopLimitOrder<Side::Buy>>(4, 102, 5, 100)).empty());
+    assert(stop_orderbook.AddOrder(std::make_shared<StopOrder<Side::Sell>>(5, 90, 10)).empty());
+    assert(stop_orderbook.Size() == 5);
+    {
+      // trading at 101 releases the stop at 100 before the one at 101
+      Trades trades = stop_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(6, 101, 5));
+      assert(trades.size() == 3);
+      assert(trades[0].GetBidTrade().m_order_id == 6 && trades[0].GetAskTrade().m_order_id == 1);
+      assert(trades[1].GetBidTrade().m_order_id == 4 && trades[1].GetAskTrade().m_order_id == 1);
+      assert(trades[2].GetBidTrade().m_order_id == 3 && trades[2].GetAskTrade().m_order_id == 2);
+    }
+    assert(stop_orderbook.Size() == 1);
+    stop_orderbook.CancelOrder(5);
+    assert(stop_orderbook.Size() == 0);
+
+    // the last trade at 102 already triggers a stop at 99, in an auction it waits for the uncross
+    stop_orderbook.BeginAuction();
+    assert(stop_orderbook.AddOrder(std::make_shared<StopOrder<Side::Buy>>(7, 99, 10)).empty());
+    assert(stop_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(8, 100, 10)).empty());
+    assert(stop_orderbook.Size() == 2);
+    {
+      Trades trades = stop_orderbook.Uncross();
+      assert(trades.size() == 1);
+      assert(trades[0].GetBidTrade().m_order_id == 7 && trades[0].GetAskTrade().m_order_id == 8);
+    }
+    assert(stop_orderbook.Size() == 0);
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Self Trade Prevention: " << std::endl;
+  {
+    auto CreateOrder = [](OrderPtr order, ParticipantId participant_id, SelfTradePrevention self_trade_prevention) {
+      order->SetParticipant(participant_id, self_trade_prevention);
+      return order;
+    };
+    Orderbook stp_orderbook;
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 10), 7, SelfTradePrevention::CancelNewest));
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(2, 100, 10), 7, SelfTradePrevention::CancelNewest)).empty());
+    assert(stp_orderbook.Size() == 1);
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(3, 100, 10), 7, SelfTradePrevention::CancelOldest)).empty());
+    assert(stp_orderbook.Size() == 1 && stp_orderbook.GetLevelInfos().first.empty());
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(4, 100, 10), 7, SelfTradePrevention::CancelBoth)).empty());
+    assert(stp_orderbook.Size() == 0);
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(5, 100, 10), 7, SelfTradePrevention::Decrement));
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(6, 100, 4), 7, SelfTradePrevention::Decrement)).empty());
+    assert(stp_orderbook.Size() == 1 && stp_orderbook.GetLevelInfos().first.front().m_quantity == 6);
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(7, 100, 6), 8, SelfTradePrevention::Decrement)).size() == 1);
+    assert(stp_orderbook.Size() == 0);
+
+    // recency is arrival in the book, not the id. the resting sell 10 is older than the incoming buy 3
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(10, 100, 10), 7, SelfTradePrevention::CancelNewest));
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(3, 100, 10), 7, SelfTradePrevention::CancelNewest)).empty());
+    assert(stp_orderbook.Size() == 1 && stp_orderbook.GetLevelInfos().second.empty());
+    stp_orderbook.CancelOrder(10);
+
+    // repricing into the participant's own sell is still prevented
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(5, 105, 10), 7, SelfTradePrevention::CancelNewest));
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(2, 100, 10), 7, SelfTradePrevention::CancelNewest));
+    assert(stp_orderbook.ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>(2, 105, 10)).empty());
+    assert(stp_orderbook.Size() == 1 && stp_orderbook.GetLevelInfos().second.empty());
+    stp_orderbook.CancelOrder(5);
+    assert(stp_orderbook.Size() == 0);
+
+    // a fill or kill cannot count its own orders it would cancel, it is killed without a trade
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(11, 100, 10), 7, SelfTradePrevention::None));
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(12, 101, 10), 8, SelfTradePrevention::None));
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(13, 101, 20), 7, SelfTradePrevention::CancelOldest)).empty());
+    assert(stp_orderbook.Size() == 2 && stp_orderbook.GetLevelInfos().second.empty());
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(14, 101, 10), 7, SelfTradePrevention::CancelOldest)).size() == 1);
+    assert(stp_orderbook.Size() == 0);
+
+    // ahead of its own order an iceberg only counts its clip, the refresh queues the rest behind the own order
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<IcebergOrder<Side::Sell>>(15, 100, 10, 2), 8, SelfTradePrevention::None));
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(16, 100, 5), 7, SelfTradePrevention::None));
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(17, 100, 10), 7, SelfTradePrevention::CancelNewest)).empty());
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(18, 100, 10), 7, SelfTradePrevention::CancelBoth)).empty());
+    assert(stp_orderbook.Size() == 2 && stp_orderbook.GetLevelInfos().first.front().m_quantity == 7);
+    // the clip alone covers a small one
+    assert(stp_orderbook.AddOrder(CreateOrder(std::make_shared<FillOrKillOrder<Side::Buy>>(19, 100, 2), 7, SelfTradePrevention::CancelNewest)).size() == 1);
+    stp_orderbook.CancelOrders({15, 16});
+    assert(stp_orderbook.Size() == 0);
+
+    // prevention during the uncross cancels the sell at 100 the price was picked for, the rest crosses at 101
+    stp_orderbook.BeginAuction();
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(20, 100, 10), 7, SelfTradePrevention::None));
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(21, 101, 10), 8, SelfTradePrevention::None));
+    stp_orderbook.AddOrder(CreateOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(22, 101, 10), 7, SelfTradePrevention::CancelOldest));
+    {
+      Trades trades = stp_orderbook.Uncross();
+      assert(trades.size() == 1 && trades[0].GetAskTrade().m_order_id == 21 && trades[0].GetBidTrade().m_price == 101);
+    }
+    assert(stp_orderbook.Size() == 0);
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Modify: " << std::endl;
+  {
+    Orderbook modify_orderbook;
+    modify_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 105, 10));
+    modify_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(2, 100, 10));
+    // repricing through the spread matches at the new price
+    assert(modify_orderbook.ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>(2, 105, 4)).size() == 1);
+    assert(modify_orderbook.Size() == 1 && modify_orderbook.GetLevelInfos().first.front().m_quantity == 6);
+    // an unknown id is a no op
+    assert(modify_orderbook.ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>(42, 105, 4)).empty());
+    assert(modify_orderbook.Size() == 1);
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Mass Cancel: " << std::endl;
+  {
+    Orderbook mass_orderbook;
+    for (OrderId id = 1; id <= 40; ++id) {
+      OrderPtr order = id <= 20 ? static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Buy>>(id, 80 + id % 10, 10))
+                                : static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Sell>>(id, 110 + id % 10, 10));
+      order->SetParticipant(1 + id % 2, SelfTradePrevention::None);
+      mass_orderbook.AddOrder(order);
+    }
+    mass_orderbook.AddOrder(std::make_shared<StopOrder<Side::Sell>>(42, 70, 10));
+    auto stop = std::make_shared<StopOrder<Side::Buy>>(41, 130, 10);
+    stop->SetParticipant(2, SelfTradePrevention::None);
+    mass_orderbook.AddOrder(stop);
+    assert(mass_orderbook.Size() == 42);
+
+    // sells at 112..114
+    mass_orderbook.CancelOrders(Side::Sell, 112, 114);
+    assert(mass_orderbook.Size() == 36 && mass_orderbook.GetLevelInfos().first.size() == 7);
+    // bids at 85..89
+    mass_orderbook.CancelOrders(Side::Buy, 85, 200);
+    assert(mass_orderbook.Size() == 26 && mass_orderbook.GetLevelInfos().second.size() == 5);
+    // even ids belong to participant 1, odd ids and the buy stop to participant 2
+    mass_orderbook.CancelParticipantOrders(2);
+    assert(mass_orderbook.Size() == 13);
+    mass_orderbook.CancelOrders(Side::Buy);
+    assert(mass_orderbook.Size() == 7 && mass_orderbook.GetLevelInfos().second.empty());
+    mass_orderbook.CancelParticipantOrders(1);
+    assert(mass_orderbook.Size() == 1);
+    mass_orderbook.CancelOrder(42);
+    assert(mass_orderbook.Size() == 0);
+
+    // a modified order is still linked into its participant's chain
+    auto order = std::make_shared<GoodTillCancelOrder<Side::Buy>>(43, 90, 10);
+    order->SetParticipant(5, SelfTradePrevention::None);
+    mass_orderbook.AddOrder(order);
+    mass_orderbook.ModifyOrder(OrderModify<GoodTillCancelOrder<Side::Buy>>(43, 91, 5));
+    mass_orderbook.CancelParticipantOrders(5);
+    assert(mass_orderbook.Size() == 0);
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Stats: " << std::endl;
+  {
+    Orderbook stats_orderbook;
+    const OrderbookStats &stats = stats_orderbook.GetStats();
+    stats_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(1, 100, 10));
+    stats_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Sell>>(2, 101, 10));
+    stats_orderbook.AddOrder(std::make_shared<GoodTillCancelOrder<Side::Buy>>(3, 100, 5));
+    assert(stats.m_orders == 3 && stats.m_trades == 1);
+    assert(stats.m_resting_orders == 2 && stats.m_ask_levels == 2 && stats.m_bid_levels == 0);
+    stats_orderbook.CancelOrders(Side::Sell);
+    assert(stats.m_cancels == 2 && stats.m_resting_orders == 0);
+    assert(stats.m_add_latency.Count() == 3 && stats.m_cancel_latency.Count() == 1);
+    assert(stats.m_add_latency.Percentile(0.5) <= stats.m_add_latency.Percentile(0.99));
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Replay: " << std::endl;
+  {
+    std::istringstream recorded{"# sequence symbol event\n"
+                                "1 AAA A Sell GTC 1 100 10\n"
+                                "2 BBB A Buy GTC 1 50 5\n"
+                                "3 AAA A Buy GTC 2 100 4\n"
+                                "4 BBB A Sell FAK 2 50 8\n"
+                                "5 CCC A Sell ICE 1 200 30 10\n"
+                                "6 CCC A Buy GTC 2 200 15\n"
+                                "7 AAA C 1\n"
+                                "8 AAA A Buy GTC 3 100 1\n"};
+    ReplayStream stream = ReplayStream::Read(recorded);
+    assert(stream.Size() == 8 && stream.GetSymbols().size() == 3);
+    std::ostringstream merged;
+    ReplayEngine::Write(merged, stream, ReplayEngine{2}.Run(stream));
+    assert(merged.str() == "1 3 AAA 2 100 4 1 100 4\n"
+                           "2 4 BBB 1 50 5 2 50 5\n"
+                           "3 6 CCC 2 200 10 1 200 10\n"
+                           "4 6 CCC 2 200 5 1 200 5\n");
+
+    bool rejected = false;
+    try {
+      std::istringstream out_of_order{"2 AAA C 1\n1 AAA C 2\n"};
+      ReplayStream::Read(out_of_order);
+    } catch (const std::invalid_argument &) {
+      rejected = true;
+    }
+    assert(rejected);
+
+    // any schedule over the pool reproduces the single threaded run
+    std::mt19937 rng{7};
+    ReplayStream random_stream;
+    std::vector<OrderId> next_id(50, 1);
+    for (uint64_t sequence = 1; sequence <= 20000; ++sequence) {
+      const std::size_t symbol = rng() % next_id.size();
+      ReplayEvent event{sequence, ReplayAction::Add, rng() % 2 ? Side::Buy : Side::Sell, "GTC", 0, static_cast<Price>(95 + rng() % 11),
+                        static_cast<Quantity>(1 + rng() % 50), 0, 0};
+      if (next_id[symbol] > 1 && rng() % 3 == 0) {
+        event.m_action = rng() % 2 ? ReplayAction::Cancel : ReplayAction::Modify;
+        event.m_order_id = 1 + rng() % (next_id[symbol] - 1);
+      } else {
+        event.m_order_id = next_id[symbol]++;
+        event.m_type = OrderTypeItems[rng() % 5];
+      }
+      random_stream.Append("S" + std::to_string(symbol), event);
+    }
+    std::ostringstream sequential, parallel;
+    ReplayEngine::Write(sequential, random_stream, ReplayEngine{1}.Run(random_stream));
+    ReplayEngine::Write(parallel, random_stream, ReplayEngine{8}.Run(random_stream));
+    assert(!sequential.str().empty() && sequential.str() == parallel.str());
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Trade Tape: " << std::endl;
+  {
+    const std::string path = (std::filesystem::temp_directory_path() / "orderbook_test.tape").string();
+    std::filesystem::remove(path);
+
+    // one trade a second for a bit over five blocks, written in two sessions to exercise appending
+    constexpr uint64_t trade_count = 5 * TradeTapeWriter::kBlockTrades + 100;
+    auto PriceAt = [](uint64_t second) { return static_cast<Price>(1000 + second % 97 - second % 13); };
+    auto QuantityAt = [](uint64_t second) { return static_cast<Quantity>(1 + second % 50); };
+    {
+      TradeTapeWriter writer{path};
+      for (uint64_t second = 0; second < trade_count / 2; ++second)
+        writer.Append(second * 1'000'000'000, PriceAt(second), QuantityAt(second), second, second + 1);
+    }
+    {
+      TradeTapeWriter writer{path};
+      for (uint64_t second = trade_count / 2; second < trade_count; ++second)
+        writer.Append(second * 1'000'000'000, PriceAt(second), QuantityAt(second), second, second + 1);
+    }
+
+    TradeTapeReader reader{path};
+    assert(reader.Size() == trade_count);
+    auto Expected = [&](uint64_t from_second, uint64_t to_second) {
+      TapeBar bar{from_second * 1'000'000'000};
+      for (uint64_t second = from_second; second < std::min(to_second, trade_count); ++second) {
+        const Price price = PriceAt(second);
+        if (!bar.m_trade_count)
+          bar.m_open = bar.m_high = bar.m_low = price;
+        bar.m_high = std::max(bar.m_high, price);
+        bar.m_low = std::min(bar.m_low, price);
+        bar.m_close = price;
+        ++bar.m_trade_count;
+        bar.m_volume += QuantityAt(second);
+        bar.m_notional += static_cast<int64_t>(price) * QuantityAt(second);
+      }
+      return bar;
+    };
+    auto Same = [](const TapeBar &lhs, const TapeBar &rhs) {
+      return lhs.m_start == rhs.m_start && lhs.m_trade_count == rhs.m_trade_count && lhs.m_volume == rhs.m_volume &&
+             lhs.m_notional == rhs.m_notional && lhs.m_open == rhs.m_open && lhs.m_high == rhs.m_high && lhs.m_low == rhs.m_low &&
+             lhs.m_close == rhs.m_close;
+    };
+
+    assert(Same(reader.Summarize(0, UINT64_MAX), Expected(0, trade_count)));
+    // whole blocks come from their headers, only the two edge blocks are decoded
+    assert(Same(reader.Summarize(1000 * 1'000'000'000ull, 15000 * 1'000'000'000ull), Expected(1000, 15000)));
+    assert(reader.DecodedBlocks() <= 2);
+    assert(reader.Summarize(trade_count * 1'000'000'000, UINT64_MAX).m_trade_count == 0);
+
+    constexpr uint64_t minute = 60 * 1'000'000'000ull;
+    TapeBars bars = reader.Bars(0, UINT64_MAX, minute);
+    assert(bars.size() == (trade_count + 59) / 60);
+    for (const auto &bar : bars)
+      assert(Same(bar, Expected(bar.m_start / 1'000'000'000, bar.m_start / 1'000'000'000 + 60)));
+
+    // the resting side prices the trade
+    {
+      TradeTapeWriter writer{path};
+      writer.Append(trade_count * 1'000'000'000, Trades{Trade{{1, 101, 5}, {2, 103, 5}}}, Side::Buy);
+      writer.Append(trade_count * 1'000'000'000, Trades{Trade{{3, 101, 5}, {4, 103, 5}}}, Side::Sell);
+    }
+    TapeBar last = TradeTapeReader{path}.Summarize(trade_count * 1'000'000'000, UINT64_MAX);
+    assert(last.m_trade_count == 2 && last.m_open == 101 && last.m_close == 103);
+    std::filesystem::remove(path);
+
+    // a session cut short mid block is dropped on reopen, the next session appends after the last complete block
+    auto Session = [&](uint64_t first_second) {
+      TradeTapeWriter writer{path};
+      for (uint64_t second = first_second; second < first_second + 10; ++second)
+        writer.Append(second * 1'000'000'000, PriceAt(second), QuantityAt(second), second, second + 1);
+    };
+    Session(0);
+    Session(10);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+    {
+      // timestamps carry on from the surviving block
+      TradeTapeWriter writer{path};
+      bool rejected = false;
+      try {
+        writer.Append(5 * 1'000'000'000ull, 100, 1, 1, 2);
+      } catch (const std::invalid_argument &) {
+        rejected = true;
+      }
+      assert(rejected);
+    }
+    Session(20);
+    TradeTapeReader reopened{path};
+    assert(reopened.Size() == 20 && reopened.BlockCount() == 2);
+    assert(Same(reopened.Summarize(20 * 1'000'000'000ull, UINT64_MAX), Expected(20, 30)));
+    std::filesystem::remove(path);
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << "Test Memory Footprint: " << std::endl;
+  {
+    constexpr std::size_t order_count = 10000;
+    constexpr std::size_t per_order_budget = 256;
+    constexpr std::size_t participant_count = 8;
+    Orderbook reserved_orderbook{{order_count, 1, 200, true, participant_count}};
+    Orderbook orderbook;
+    MemoryFootprint footprint = reserved_orderbook.GetMemoryFootprint();
+    assert(footprint.m_reserved_bytes > 0 && footprint.m_pool_bytes == footprint.m_reserved_bytes);
+
+    for (OrderId id = 1; id <= order_count; ++id) {
+      for (auto *book : {&reserved_orderbook, &orderbook}) {
+        OrderPtr order = id % 2 ? static_cast<OrderPtr>(std::make_shared<GoodTillCancelOrder<Side::Buy>>(id, 1 + id % 100, 10))
+                                : static_cast<OrderPtr>(std::make_shared<IcebergOrder<Side::Sell>>(id, 101 + id % 100, 10, 2));
+        order->SetParticipant(1 + id % participant_count, SelfTradePrevention::None);
+        book->AddOrder(order);
+      }
+    }
+    footprint = reserved_orderbook.GetMemoryFootprint();
+    assert(footprint.m_order_count == order_count);
+    // the expected orders fit what was reserved, the pool never went upstream during the session
+    assert(footprint.m_pool_bytes <= footprint.m_reserved_bytes);
+    assert(footprint.m_order_bytes == order_count / 2 * (sizeof(GoodTillCancelOrder<Side::Buy>) + sizeof(IcebergOrder<Side::Sell>)) +
+                                          order_count * 2 * sizeof(void *));
+    // the pool draws whole chunks, it never holds less than the live nodes
+    assert(footprint.m_pool_bytes >= footprint.m_level_bytes + footprint.m_queue_bytes + footprint.m_index_bytes);
+    std::cout << "Bytes per order: " << footprint.PerOrder() << ", pool bytes: " << footprint.m_pool_bytes << std::endl;
+    assert(footprint.PerOrder() <= per_order_budget);
+
+    footprint = orderbook.GetMemoryFootprint();
+    assert(footprint.m_reserved_bytes == 0);
+    std::cout << "Bytes per order without a hint: " << footprint.PerOrder() << ", pool bytes: " << footprint.m_pool_bytes << std::endl;
+    assert(footprint.PerOrder() <= per_order_budget);
+  }
+  std::cout << "Test passed" << std::endl;
+  std::cout << std::endl;
 }